@@ -329,13 +329,14 @@ public:
 	template <uint16_t descriptor>
 	SoftIntHandler& txHandler();
 
+	// Обработчик прерывания CANIT. Открыт для INTERRUPT_STATIC (interrupt-static.h)
+	void interruptHandler ();
+
 
 private:
 	enum { txNumber = Length<TxDescriptorGroupList>::value };
 	enum { rxGroupNumber = Length<RxDescriptorGroupList>::value };
 
-	void interruptHandler ();
-
 	// Инициализация Tx MOb'ов ->
 	template<class TList, uint8_t num = 0> struct InitTxList;
 
@@ -851,6 +852,7 @@ template <	class TxDescriptorGroupList, class RxDescriptorGroupList,
 void CanDat<TxDescriptorGroupList, RxDescriptorGroupList, RxDescriptorInterruptList, dataBufferSize, TxDescriptorInterruptList, baudKbit, samplePointPercent>
 		::interruptHandler ()
 {
+	PROFILE_ENTER(CriticalProfile::canInterrupt);
 	if ( reg.canGeneralStatus.busOff )
 		reboot ();
 	reg.canGeneralStatus = 0xFF; // Снимаем флаги. Интерфейся для снятия флага - запись 1.
@@ -863,6 +865,7 @@ void CanDat<TxDescriptorGroupList, RxDescriptorGroupList, RxDescriptorInterruptL
 
 		Bitfield<CanMobStatus> status = reg.canMobStatus;
 		reg.canMobStatus = 0; // Снимаем флаг прерывания, чтобы не войти вновь
+		PROFILE_EXIT(CriticalProfile::canInterrupt);
 		sei (); // После этого можно разрешить прерывания глобально
 
 		if ( status.receiveFinish )
@@ -906,6 +909,8 @@ void CanDat<TxDescriptorGroupList, RxDescriptorGroupList, RxDescriptorInterruptL
 
 		reg.canPage = canPageSave;
 	}
+	else
+		PROFILE_EXIT(CriticalProfile::canInterrupt);
 }
 
 #endif /* CANDAT_H_ */
@@ -0,0 +1,188 @@
+/*
+ * critical-profile.h
+ *
+ * Измерение длительности критических секций и обработчиков прерываний
+ * ********************************************************************
+ *
+ *  ~~~ Проблема: ~~~
+ *  Почти все модули библиотеки (ATOMIC в Safe, Dispatcher, Scheduler::runIn, Eeprom::writeUnblock,
+ *  обработчики Clock и CanDat) запрещают прерывания. Каково наихудшее окно cli - неизвестно.
+ *
+ *  ~~~ Решение: ~~~
+ *  1. Каждая критическая секция и обработчик прерывания библиотеки помечены номером места (Site).
+ *  2. На входе и выходе считывается свободно бегущий 16-битный таймер.
+ *     Для каждого места запоминается число вызовов, максимум и гистограмма длительностей.
+ *  3. Включается определением CRITICAL_PROFILE до подключения заголовков библиотеки.
+ *     Без него все макросы раскрываются в ничто (или в обычный ATOMIC) и не дают никакого кода.
+ *
+ *  ~~~ Настройка: ~~~
+ *  CRITICAL_PROFILE			- включает измерения
+ *  CRITICAL_PROFILE_COUNTER	- счётный регистр таймера (по умолчанию TCNT3).
+ *  							  Таймер должен быть запущен пользователем в режиме Normal.
+ *  							  Длительности измеряются в тактах этого таймера.
+ *  							  При делителе 1 максимальная измеримая длительность - 65535 тактов ЦПУ.
+ *  CRITICAL_PROFILE_SITES		- общее число мест, включая пользовательские (по умолчанию userSite + 8)
+ *
+ *  ~~~ Интерфейс: ~~~
+ *  PROFILE_ATOMIC(site)		- замена ATOMIC, измеряющая время под запретом прерываний
+ *  PROFILE_SCOPE(site)			- измерение от этой точки до конца блока (для обработчиков прерываний).
+ *  							  Если обработчик разрешает вложенные прерывания, то блок закрывается до sei(),
+ *  							  иначе в измерение попадают чужие обработчики
+ *  PROFILE_ENTER(site) / PROFILE_EXIT(site)
+ *  							- измерение участка с ручными cli и SREG = sreg; EXIT может стоять в нескольких ветках
+ *  criticalProfile.record(site)	- результаты по месту: count, max, histogram[]
+ *  criticalProfile.worstSite()		- место с наибольшим максимумом
+ *  criticalProfile.reset()
+ *
+ *  Гистограмма: ячейка 0 - менее 16 тактов таймера, ячейка n - от 8<<n до 16<<n, последняя - всё, что больше.
+ *
+ *  ~~~ Пример использования: ~~~
+	#define CRITICAL_PROFILE
+	#include <cpp/critical-profile.h>
+	#include <cpp/timers.h>
+
+	void myIsr ()
+	{
+		PROFILE_SCOPE (CriticalProfile::userSite);
+		// ...
+	}
+
+	int main ()
+	{
+		reg.timer3Control.clockType = TimerControl16::Prescale1;	// Свободно бегущий таймер
+		// ...
+		uint8_t worst = criticalProfile.worstSite ();
+		uint16_t ticks = criticalProfile.record (worst).max;
+	}
+ *
+ */
+
+#ifndef CRITICAL_PROFILE_H_
+#define CRITICAL_PROFILE_H_
+
+#include <avr/io.h>
+#include <cpp/Chizhov/AVR/atomic.h>
+
+namespace CriticalProfile
+{
+	enum Site : uint8_t
+	{
+		safe,				// ATOMIC в Safe<T>
+		dispatcher,			// Dispatcher::add, Dispatcher::invoke
+		scheduler,			// Scheduler::runIn
+		eepromWrite,		// Eeprom::writeUnblock
+		eepromInterrupt,	// Обработчик EE_READY
+		clockInterrupt,		// Clock::incTime
+		canInterrupt,		// CanDat::interruptHandler
+		port,				// PortPins
+		spi,				// SpiMaster::transfer
+		spiInterrupt,		// Обработчик SPI_STC в SpiMaster
+		userSite			// Первый номер для пользовательских мест
+	};
+}
+
+#ifdef CRITICAL_PROFILE
+
+#ifndef CRITICAL_PROFILE_COUNTER
+#define CRITICAL_PROFILE_COUNTER TCNT3
+#endif
+
+#ifndef CRITICAL_PROFILE_SITES
+#define CRITICAL_PROFILE_SITES (CriticalProfile::userSite + 8)
+#endif
+
+namespace CriticalProfile
+{
+	enum { histogramSize = 8 };
+
+	struct Record
+	{
+		uint16_t count;
+		uint16_t max;
+		uint16_t histogram[histogramSize];
+	};
+
+	class Profile
+	{
+	public:
+		static uint16_t stamp () { return CRITICAL_PROFILE_COUNTER; }
+
+		void add (uint8_t site, uint16_t start)
+		{
+			uint16_t duration = stamp() - start;
+
+			uint8_t bin = 0;
+			for (uint16_t d = duration >> 4; d != 0 && bin < histogramSize-1; d >>= 1)
+				bin ++;
+
+			ATOMIC
+			{
+				Record& r = records[site];
+				if (r.count != 0xFFFF)
+					r.count ++;
+				if (r.max < duration)
+					r.max = duration;
+				if (r.histogram[bin] != 0xFFFF)
+					r.histogram[bin] ++;
+			}
+		}
+
+		const Record& record (uint8_t site) const { return records[site]; }
+
+		uint8_t worstSite () const
+		{
+			uint8_t worst = 0;
+			for (uint8_t i = 1; i < CRITICAL_PROFILE_SITES; ++i)
+				if (records[i].max > records[worst].max)
+					worst = i;
+			return worst;
+		}
+
+		void reset ()
+		{
+			ATOMIC
+			{
+				for (Record& r : records)
+					r = Record ();
+			}
+		}
+
+	private:
+		Record records[CRITICAL_PROFILE_SITES];
+	};
+
+	extern Profile profile;
+
+	template<uint8_t site>
+	class Scope
+	{
+	public:
+		Scope () : start (Profile::stamp()) {}
+		~Scope () { profile.add (site, start); }
+		operator bool () { return false; }
+	private:
+		uint16_t start;
+	};
+}
+
+CriticalProfile::Profile CriticalProfile::profile;
+CriticalProfile::Profile& criticalProfile = CriticalProfile::profile;
+
+#define PROFILE_ATOMIC(site) \
+	if ( DisableInterrupts di = DisableInterrupts() ) {} \
+	else if ( CriticalProfile::Scope<site> profileScope = CriticalProfile::Scope<site>() ) {} \
+	else
+#define PROFILE_SCOPE(site) CriticalProfile::Scope<site> profileScope_
+#define PROFILE_ENTER(site) uint16_t profileStart_ = CriticalProfile::Profile::stamp()
+#define PROFILE_EXIT(site) CriticalProfile::profile.add (site, profileStart_)
+
+#else // ifdef CRITICAL_PROFILE
+
+#define PROFILE_ATOMIC(site) ATOMIC
+#define PROFILE_SCOPE(site)
+#define PROFILE_ENTER(site)
+#define PROFILE_EXIT(site) ((void)0)
+
+#endif // ifdef CRITICAL_PROFILE
+
+#endif /* CRITICAL_PROFILE_H_ */
@@ -56,6 +56,7 @@
 #define DISPATCHER_H_
 
 #include <cpp/delegate/delegate.hpp>
+#include <cpp/critical-profile.h>
 
 typedef Delegate<void (uint16_t)> SoftIntHandler;
 
@@ -93,8 +94,8 @@ public:
 
 	void invoke ()
 	{
-		Command com;
-		ATOMIC
+		Command com = Command ();
+		PROFILE_ATOMIC(CriticalProfile::dispatcher)
 		{
 			if (head != tail)
 			{
@@ -117,7 +118,7 @@ private:
 	uint8_t blockNumber ()
 	{
 		uint8_t blockedNumber;
-		ATOMIC
+		PROFILE_ATOMIC(CriticalProfile::dispatcher)
 		{
 			blockedNumber = tail;
 			if ( ++tail == head )
@@ -0,0 +1,179 @@
+/*
+ * eeprom-cached.h
+ *
+ * Переменная в eeprom с копией в ram и отложенной записью
+ * *******************************************************
+ *
+ *  ~~~ Проблема: ~~~
+ *  Eeprom<Type>::operator= сразу пишет в eeprom. Счётчик, изменяемый 100 раз в секунду,
+ *  останавливает программу на 4,5 мсек на байт и быстро изнашивает ячейки.
+ *
+ *  ~~~ Решение: ~~~
+ *  1. Значение хранится в ram (shadow), чтение идёт из неё без ожидания.
+ *  2. Запись меняет только shadow и расширяет грязный диапазон байт [dirtyFirst, dirtyLast].
+ *  3. Первая запись после сброса диапазона ставит в планировщик задачу сброса через flushInterval.
+ *     Задача отправляет грязный диапазон в EepromQueue в режиме update: в eeprom пишутся только изменившиеся байты.
+ *     Все изменения за интервал объединяются в одну запись.
+ *  4. sync() отправляет грязный диапазон в очередь немедленно.
+ *  5. powerFail() пишет блокирующе, прямо в месте вызова (обработчик пропадания питания), грязный диапазон
+ *     и диапазон, уже отправленный в очередь, но ещё не записанный. Запись идёт через eepromUpdateBlock,
+ *     поэтому копия eeprom в ram (EEPROM_MIRROR) остаётся верной.
+ *
+ *  ~~~ Интерфейс: ~~~
+ *  EepromCached< Type, Queue, queue, Scheduler, scheduler, flushInterval > var (eepromVar);
+ *  - eepromVar - Eeprom<Type> в EEMEM, значение которого считывается в конструкторе
+ *  - flushInterval - в единицах часов планировщика. 0 - только по sync() и powerFail()
+ *  var = value;			// запись в ram
+ *  var.set (&Type::field, value);	// запись одного поля структуры
+ *  value = var;			// чтение из ram
+ *  var.sync ();			// false - очередь заполнена, данные остаются грязными
+ *  var.powerFail ();
+ *  var.isDirty ();
+ *
+ *  ~~~ Ограничения: ~~~
+ *  1. Запись только из основного цикла (scheduler.runIn нельзя прерывать вызовом runIn).
+ *  2. Очередь не копирует данные, а читает shadow во время записи. Если shadow изменилась во время записи,
+ *     то изменённые байты снова помечаются грязными и будут записаны при следующем сбросе.
+ *  3. Запрос в очереди powerFail() не отменяет: если питание сохранится, то очередь продолжит его,
+ *     но все байты уже совпадут с shadow и будут пропущены (режим update).
+ *
+ *  ~~~ Пример использования: ~~~
+	struct Settings { uint16_t counter; uint8_t mode; };
+	Eeprom<Settings> settingsStored EEMEM;
+
+	Clock< Alarm<Alarm1A, 1000>, uint32_t > clock;
+	Scheduler< Clock< Alarm<Alarm1A, 1000>, uint32_t >, clock, 16, uint16_t > scheduler;
+	EepromQueue<4> eepromQueue;
+
+	EepromCached< Settings, EepromQueue<4>, eepromQueue, decltype(scheduler), scheduler, 5000 > settings (settingsStored);
+
+	void count ()
+	{
+		settings.set (&Settings::counter, settings.get().counter + 1);	// в eeprom попадёт не чаще раза в 5 сек
+	}
+
+	ISR (ANALOG_COMP_vect)	// Пропадание питания
+	{
+		settings.powerFail ();
+	}
+ *
+ */
+
+#ifndef EEPROM_CACHED_H_
+#define EEPROM_CACHED_H_
+
+#include <cpp/eeprom.h>
+
+template< typename Type,
+		  class Queue, Queue& queue,
+		  class Scheduler, Scheduler& scheduler,
+		  uint16_t flushInterval >
+class EepromCached
+{
+public:
+	explicit EepromCached (Eeprom<Type>& storage_)
+		: storage ((uint8_t*)&storage_), dirtyFirst (sizeof(Type)), dirtyLast (0),
+		  queuedFirst (sizeof(Type)), queuedLast (0), queuedCount (0), flushPending (false)
+	{
+		eeprom_read_block (&shadow, storage, sizeof(Type));
+	}
+
+	void operator= (const Type& value)
+	{
+		write (0, (const uint8_t*)&value, sizeof(Type));
+	}
+	template<typename Field>
+	void set (Field Type::* field, const typename Identity<Field>::Type& value)
+	{
+		write ( (uint8_t*)&(shadow.*field) - (uint8_t*)&shadow, (const uint8_t*)&value, sizeof(Field) );
+	}
+
+	operator const Type& () const { return shadow; }
+	const Type& get () const { return shadow; }
+
+	bool isDirty () const { return dirtyFirst <= dirtyLast; }
+
+	bool sync ()
+	{
+		if ( !isDirty() )
+			return true;
+		if ( !queue.update (storage + dirtyFirst, (uint8_t*)&shadow + dirtyFirst, dirtyLast - dirtyFirst + 1,
+							Command{SoftIntHandler::from_method<EepromCached, &EepromCached::written>(this), 0}) )
+			return false;
+		if ( dirtyFirst < queuedFirst )
+			queuedFirst = dirtyFirst;
+		if ( dirtyLast > queuedLast )
+			queuedLast = dirtyLast;
+		queuedCount ++;
+		clean ();
+		return true;
+	}
+
+	void powerFail ()
+	{
+		volatile uint8_t sreg = reg.status;
+		cli ();
+		uint16_t first = dirtyFirst < queuedFirst ? dirtyFirst : queuedFirst;
+		uint16_t last = dirtyLast > queuedLast ? dirtyLast : queuedLast;
+		if ( first <= last )
+		{
+			eeprom_busy_wait ();	// Байт, который сейчас пишет очередь
+			eepromUpdateBlock (storage + first, (uint8_t*)&shadow + first, last - first + 1);
+			clean ();
+		}
+		reg.status = sreg;
+	}
+
+private:
+	Type shadow;
+	uint8_t* storage;
+	uint16_t dirtyFirst;
+	uint16_t dirtyLast;
+	uint16_t queuedFirst;			// Диапазон, отправленный в очередь и ещё не записанный
+	uint16_t queuedLast;
+	uint8_t queuedCount;
+	bool flushPending;
+
+	void write (uint16_t offset, const uint8_t* from, uint16_t length)
+	{
+		uint8_t* to = (uint8_t*)&shadow + offset;
+		for (uint16_t i = 0; i < length; ++i)
+			if ( to[i] != from[i] )
+			{
+				to[i] = from[i];
+				if ( offset+i < dirtyFirst )
+					dirtyFirst = offset+i;
+				if ( offset+i > dirtyLast )
+					dirtyLast = offset+i;
+			}
+
+		if ( flushInterval != 0 && isDirty() && !flushPending )
+			if ( scheduler.runIn (Command{SoftIntHandler::from_method<EepromCached, &EepromCached::flush>(this), 0}, flushInterval) )
+				flushPending = true;
+	}
+
+	void clean ()
+	{
+		dirtyFirst = sizeof(Type);
+		dirtyLast = 0;
+	}
+
+	void written (uint16_t)
+	{
+		if ( --queuedCount == 0 )
+		{
+			queuedFirst = sizeof(Type);
+			queuedLast = 0;
+		}
+	}
+
+	void flush (uint16_t)
+	{
+		flushPending = false;
+		if ( !sync() ) // Очередь заполнена - попробуем позже
+			if ( scheduler.runIn (Command{SoftIntHandler::from_method<EepromCached, &EepromCached::flush>(this), 0}, flushInterval) )
+				flushPending = true;
+	}
+};
+
+#endif /* EEPROM_CACHED_H_ */
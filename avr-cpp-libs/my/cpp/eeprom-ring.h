@@ -0,0 +1,184 @@
+/*
+ * eeprom-ring.h
+ *
+ * Кольцевое хранилище в eeprom с равномерным износом
+ * **************************************************
+ *
+ *  ~~~ Проблема: ~~~
+ *  Пробег и счётчики событий, хранимые в Eeprom<uint32_t>, постоянно перезаписывают одни и те же 4 байта.
+ *  Ресурс ячейки (100 000 циклов) становится ограничением срока службы.
+ *
+ *  ~~~ Решение: ~~~
+ *  1. Под значение отводится область из records записей { sequence, value, crc }.
+ *     Каждая новая запись пишется в следующую ячейку кольца, поэтому каждая ячейка изнашивается в records раз медленнее.
+ *  2. sequence (1 байт) увеличивается на 1 с каждой записью. Записи с номерами 0...newest текущего круга
+ *     удовлетворяют условию sequence[i] - sequence[0] == i (по модулю 256), остальные - нет.
+ *     Поэтому самая новая запись находится при запуске двоичным поиском: log2(records) чтений sequence вместо records.
+ *  3. Запись идёт через EepromQueue (прерывание EE_READY). Очередь пишет байты от старшего адреса к младшему,
+ *     поэтому sequence записывается последним. Если питание пропало во время записи, то sequence остаётся старым,
+ *     и при запуске запись просто не найдётся. Если же запись всё-таки испорчена, то crc не сойдётся,
+ *     и значение берётся из предыдущей записи.
+ *     Шаг назад не доходит до записи, следующей за найденной, - туда могла попасть недописанная запись.
+ *  4. Пока идёт запись, новые значения только запоминаются в ram. По окончании записи пишется последнее из них.
+ *     Поэтому частые изменения не переполняют очередь.
+ *
+ *  ~~~ Интерфейс: ~~~
+ *  EepromRingStorage<Type, records> storage EEMEM;			// Область в eeprom: records * (sizeof(Type)+2) байт
+ *  EepromRing<Type, records, Queue, queue> var (storage);	// В конструкторе находит последнее значение
+ *  var = value;		// Неблокирующая запись
+ *  value = var;		// Чтение из ram
+ *  var.sync ();		// Повторяет запись, если очередь была заполнена. false - запись ещё не поставлена
+ *
+ *  ~~~ Ограничения: ~~~
+ *  1. 2 <= records <= 255.
+ *  2. Запись только из основного цикла.
+ *  3. До первой записи (чистая eeprom) значение равно Type().
+ *
+ *  ~~~ Пример использования: ~~~
+	EepromQueue<4> eepromQueue;
+
+	EepromRingStorage<uint32_t, 64> odometerStorage EEMEM;	// 384 байта, ресурс x64
+	EepromRing<uint32_t, 64, EepromQueue<4>, eepromQueue> odometer (odometerStorage);
+
+	void metreTick ()
+	{
+		odometer = odometer.get() + 1;
+	}
+ *
+ */
+
+#ifndef EEPROM_RING_H_
+#define EEPROM_RING_H_
+
+#include <util/crc16.h>
+#include <cpp/eeprom.h>
+
+template<typename Type, uint8_t records>
+struct EepromRingStorage
+{
+	struct Record
+	{
+		uint8_t sequence;	// Младший адрес - пишется последним
+		Type value;
+		uint8_t crc;
+	};
+
+	Record record[records];
+};
+
+template<typename Type, uint8_t records, class Queue, Queue& queue>
+class EepromRing
+{
+public:
+	typedef EepromRingStorage<Type, records> Storage;
+	typedef typename Storage::Record Record;
+
+	explicit EepromRing (Storage& storage_)
+		: storage (storage_), value (), writing (false), waiting (false)
+	{
+		static_assert (records >= 2, "EepromRing needs at least 2 records");
+
+		// Двоичный поиск самой новой записи
+		uint8_t sequence0 = readSequence (0);
+		uint8_t low = 0;
+		uint8_t high = records - 1;
+		while ( low < high )
+		{
+			uint8_t middle = ((uint16_t)low + high + 1) / 2;
+			if ( uint8_t(readSequence (middle) - sequence0) == middle )
+				low = middle;
+			else
+				high = middle - 1;
+		}
+		current = low;
+
+		// Проверка crc, при ошибке - шаг назад. Запись после current не проверяется: если питание пропало
+		// во время её записи, то недописанная запись может случайно сойтись по crc (1 из 256)
+		uint8_t n = current;
+		for (uint8_t i = 0; i < records - 1; ++i)
+		{
+			Record r;
+			eeprom_read_block (&r, &storage.record[n], sizeof(Record));
+			if ( r.crc == crc (r) )
+			{
+				value = r.value;
+				current = n;
+				break;
+			}
+			n = (n == 0 ? records : n) - 1;
+		}
+		sequence = readSequence (current);
+	}
+
+	void operator= (const Type& value_)
+	{
+		value = value_;
+		if ( writing )
+			waiting = true;
+		else
+			startWrite ();
+	}
+
+	operator const Type& () const { return value; }
+	const Type& get () const { return value; }
+
+	bool sync ()
+	{
+		if ( waiting && !writing )
+			startWrite ();
+		return !waiting;
+	}
+
+private:
+	Storage& storage;
+	Type value;
+	Record pending;			// Буфер записи, очередь читает его во время записи
+	uint8_t current;		// Номер последней записи
+	uint8_t sequence;		// Её sequence
+	bool writing;
+	bool waiting;
+
+	uint8_t readSequence (uint8_t n)
+	{
+		return eeprom_read_byte (&storage.record[n].sequence);
+	}
+
+	static uint8_t crc (const Record& r)
+	{
+		uint8_t c = 0;
+		for (const uint8_t* p = (const uint8_t*)&r; p != &r.crc; ++p)
+			c = _crc_ibutton_update (c, *p);
+		return c;
+	}
+
+	void startWrite ()
+	{
+		uint8_t next = current + 1 == records ? 0 : current + 1;
+		pending.sequence = sequence + 1;
+		pending.value = value;
+		pending.crc = crc (pending);
+
+		waiting = false;
+		writing = true;
+		if ( queue.update (&storage.record[next], &pending, sizeof(Record),
+						   Command{SoftIntHandler::from_method<EepromRing, &EepromRing::written>(this), 0}) )
+		{
+			current = next;
+			sequence ++;
+		}
+		else // Очередь заполнена
+		{
+			writing = false;
+			waiting = true;
+		}
+	}
+
+	void written (uint16_t)
+	{
+		writing = false;
+		if ( waiting )
+			startWrite ();
+	}
+};
+
+#endif /* EEPROM_RING_H_ */
@@ -0,0 +1,170 @@
+/*
+ * eeprom-transaction.h
+ *
+ * Атомарное изменение группы переменных в eeprom
+ * **********************************************
+ *
+ *  ~~~ Проблема: ~~~
+ *  Конфигурация состоит из нескольких переменных, которые должны меняться вместе.
+ *  Сброс посреди записи оставляет смесь старых и новых значений,
+ *  поэтому при каждом запуске приходится проверять всю конфигурацию поле за полем.
+ *
+ *  ~~~ Решение: ~~~
+ *  1. Переменные объединяются в структуру Type. В eeprom хранятся две её копии (area[0] и area[1]),
+ *     каждая с crc16, и байт commit - номер действующей копии.
+ *  2. begin() возвращает рабочую копию в ram, в которой меняются нужные поля.
+ *  3. commit() ставит в EepromQueue два запроса: запись рабочей копии с crc в НЕдействующую область
+ *     и затем запись commit. Очередь выполняет их по порядку, поэтому commit меняется только после
+ *     полной записи области. До этого момента действующая копия не тронута.
+ *  4. При запуске читается commit и проверяется crc одной области. Если crc не сошёлся
+ *     (например, повреждён сам commit), проверяется вторая область.
+ *
+ *  ~~~ Интерфейс: ~~~
+ *  EepromTransactionStorage<Type> storage EEMEM;			// 2 * (sizeof(Type)+2) + 1 байт
+ *  EepromTransaction<Type, Queue, queue> config (storage);
+ *  const Type& v = config.get ();		// Действующие значения в ram
+ *  config.isValid ();					// false - ни одна область не прошла проверку crc (чистая eeprom), get() == Type()
+ *  Type& t = config.begin ();			// Рабочая копия = действующие значения
+ *  t.field = ...;
+ *  config.commit (done);				// false - предыдущий commit не закончен или очередь заполнена
+ *  config.isCommitting ();
+ *
+ *  ~~~ Ограничения: ~~~
+ *  1. Между commit() и выполнением done рабочую копию менять нельзя: очередь пишет прямо из неё.
+ *  2. В очереди должно быть 2 свободных места.
+ *
+ *  ~~~ Пример использования: ~~~
+	struct Config { uint16_t canId; uint8_t baud; int16_t offset[4]; };
+
+	EepromQueue<4> eepromQueue;
+	EepromTransactionStorage<Config> configStorage EEMEM;
+	EepromTransaction<Config, EepromQueue<4>, eepromQueue> config (configStorage);
+
+	void applyCanSettings (uint16_t canId, uint8_t baud)
+	{
+		Config& c = config.begin ();
+		c.canId = canId;
+		c.baud = baud;
+		config.commit ();		// canId и baud изменятся в eeprom только вместе
+	}
+
+	int main ()
+	{
+		if ( !config.isValid () )
+		{
+			config.begin () = Config{0x100, 100, {0, 0, 0, 0}};
+			config.commit ();
+		}
+	}
+ *
+ */
+
+#ifndef EEPROM_TRANSACTION_H_
+#define EEPROM_TRANSACTION_H_
+
+#include <util/crc16.h>
+#include <cpp/eeprom.h>
+
+template<typename Type>
+struct EepromTransactionStorage
+{
+	struct Area
+	{
+		Type value;
+		uint16_t crc;
+	};
+
+	Area area[2];
+	uint8_t commit;
+};
+
+template<typename Type, class Queue, Queue& queue>
+class EepromTransaction
+{
+public:
+	typedef EepromTransactionStorage<Type> Storage;
+	typedef typename Storage::Area Area;
+
+	explicit EepromTransaction (Storage& storage_)
+		: storage (storage_), committing (false)
+	{
+		active = eeprom_read_byte (&storage.commit) & 1;
+		valid = load (active);
+		if ( !valid )
+		{
+			active ^= 1;
+			valid = load (active);
+		}
+		if ( !valid )
+			value = Type ();
+	}
+
+	const Type& get () const { return value; }
+	bool isValid () const { return valid; }
+	bool isCommitting () const { return committing; }
+
+	Type& begin ()
+	{
+		staged.value = value;
+		return staged.value;
+	}
+
+	bool commit (const Command& done_ = Command())
+	{
+		if ( committing )
+			return false;
+
+		staged.crc = crc (staged);
+		commitByte = active ^ 1;
+		done = done_;
+
+		committing = true;
+		if ( queue.write (&storage.area[commitByte], &staged, sizeof(Area)) &&
+			 queue.write (&storage.commit, &commitByte, 1,
+						  Command{SoftIntHandler::from_method<EepromTransaction, &EepromTransaction::committed>(this), 0}) )
+			return true;
+
+		// Область без commit не действует, её запись безвредна
+		committing = false;
+		return false;
+	}
+
+private:
+	Storage& storage;
+	Type value;				// Действующие значения
+	Area staged;			// Рабочая копия, из неё пишет очередь
+	Command done;
+	uint8_t active;			// Номер действующей области
+	uint8_t commitByte;		// Буфер для записи commit
+	bool valid;
+	bool committing;
+
+	static uint16_t crc (const Area& a)
+	{
+		uint16_t c = 0xFFFF;
+		for (const uint8_t* p = (const uint8_t*)&a.value; p != (const uint8_t*)&a.crc; ++p)
+			c = _crc16_update (c, *p);
+		return c;
+	}
+
+	bool load (uint8_t n)
+	{
+		eeprom_read_block (&staged, &storage.area[n], sizeof(Area));
+		if ( staged.crc != crc (staged) )
+			return false;
+		value = staged.value;
+		return true;
+	}
+
+	void committed (uint16_t)
+	{
+		active = commitByte;
+		value = staged.value;
+		valid = true;
+		committing = false;
+		if ( done.handler )
+			done.handler (done.parameter);
+	}
+};
+
+#endif /* EEPROM_TRANSACTION_H_ */
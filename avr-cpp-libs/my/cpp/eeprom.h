@@ -21,6 +21,9 @@
  *     Функция неблокирующей записи возвращает false в случае:
  *     - если на момент вызова происходит неблокирующая запись с помощью класса Eeprom
  *     - если на момент вызова происходит запись в eeprom с помощью любых методов
+ *  3. Для больших объектов (таблицы калибровки, структуры настроек) - очередь запросов EepromQueue<size>.
+ *     Запрос - адрес в eeprom, буфер в ram и длина. Прерывание EE_READY по окончанию запроса
+ *     ставит в диспетчер Command запроса и сразу начинает следующий. Основной цикл не ждёт никогда.
  *
  *  ~~~ Условия, налагаемые на работу с eeprom помимо класса Eeprom: ~~~
  *  Совместно с объектами класса Eeprom в eeprom-памяти могут быть расположены традиционные переменные.
@@ -37,6 +40,30 @@
  *  Или же использовать неблокирующую запись:
  *  void wait (uint16_t pointer); // функция для вызова по завершению записи
  *  var.updateUnblock( 5, SoftIntHandler::from_function<&wait>() );
+ *  writeUnblock/updateUnblock доступны для типов до 4 байт, блокирующие операции - для любых.
+ *
+ *  Очередь неблокирующей записи (глубина size задаётся при компиляции):
+ *  EepromQueue<8> eepromQueue;
+ *  eepromQueue.write (eepromVar, ramVar, command);	// или update (...) - пишет только изменившиеся байты
+ *  eepromQueue.write (eepromAddress, ramPointer, length, command);
+ *  - возвращают false, если очередь заполнена
+ *  - буфер в ram не копируется и должен оставаться неизменным до выполнения command
+ *  - пока очередь не пуста, writeUnblock возвращает false
+ *  - очередей может быть несколько (например, у разных модулей). Каждая новая очередь запоминает предыдущую,
+ *    и прерывание опрашивает их цепочкой: сначала последнюю созданную. Очереди должны существовать всё время работы
+ *
+ *  Копия eeprom в ram (EEPROM_MIRROR):
+ *  Чтение Eeprom<Type> ждёт готовности eeprom и может простоять за неблокирующей записью несколько мсек.
+ *  Если до подключения определить EEPROM_MIRROR, то при запуске вся секция .eeprom (все переменные EEMEM,
+ *  от 0 до __eeprom_end) одним проходом копируется в ram, и чтение Eeprom<Type> идёт из ram за постоянное время.
+ *  Запись через Eeprom<Type>, writeUnblock и EepromQueue обновляет обе копии (ram - сразу при постановке).
+ *  Запись в обход (eeprom_write_* напрямую) копию не обновляет, для блокирующей записи участка eeprom
+ *  в обход Eeprom<Type> есть eepromUpdateBlock (to, from, length).
+ *  EEPROM_MIRROR_SIZE - размер копии в ram (по умолчанию 256 байт). Если .eeprom больше, то копия не используется.
+ *  Чтобы такая сборка не проходила молча, в линковку добавляется скрипт cpp/eeprom-mirror.ld:
+ *    avr-g++ ... main.o path/to/cpp/eeprom-mirror.ld
+ *  Он проверяет размер .eeprom против EEPROM_MIRROR_SIZE, и линковка останавливается с ошибкой.
+ *  Во время работы eepromIsMirrored () == false, если копия не используется.
  *
  *
  *  ~~~ Пример использования: ~~~
@@ -83,6 +110,20 @@
 			dispatcher.invoke ();
 		}
 	}
+
+
+	// Очередь записи
+	struct Calibration { int16_t offset[16]; uint16_t gain[16]; };
+	Eeprom<Calibration> calibrationStored EEMEM;
+	Calibration calibration;
+	EepromQueue<4> eepromQueue;
+
+	void calibrationSaved (uint16_t) {}
+
+	void saveCalibration ()
+	{
+		eepromQueue.update ( calibrationStored, calibration, Command{SoftIntHandler::from_function<&calibrationSaved>(), 0} );
+	}
  *
  */
 
@@ -95,110 +136,201 @@
 #include <cpp/interrupt-dynamic.h>
 #include <cpp/dispatcher.h>
 
+#ifdef EEPROM_MIRROR
+#ifndef EEPROM_MIRROR_SIZE
+#define EEPROM_MIRROR_SIZE 256
+#endif
+extern "C" uint8_t __eeprom_end; // Конец секции .eeprom, определён в скрипте линкера
+// Размер копии для проверки в eeprom-mirror.ld
+#define EEPROM_MIRROR_STRING_(x) #x
+#define EEPROM_MIRROR_STRING(x) EEPROM_MIRROR_STRING_(x)
+asm (".global __eeprom_mirror_size\n\t.set __eeprom_mirror_size, " EEPROM_MIRROR_STRING(EEPROM_MIRROR_SIZE));
+#endif
+
 
 namespace EepromStaticPrivate
 {
 	bool updateMode = false;
-	volatile uint8_t byteNumber = 0; 	// 0 - no active write, 1...4 - active
-	Complex<uint32_t> writingVar;		// 4 байта максимум
+	volatile bool active = false;		// Запись (или очередь записей) занимает eeprom до прерывания завершения
+	volatile uint16_t byteNumber = 0; 	// Осталось записать байт в текущем запросе
+	Complex<uint32_t> writingVar;		// Копия значения для writeUnblock, 4 байта максимум
+	const uint8_t* source;				// Откуда пишем: writingVar или буфер из очереди
 	uint8_t* startAddress;				// address of low byte
-	SoftIntHandler afterWrite;
+	Command afterWrite;
+	// Пустой Delegate вызывает empty_function, которая для bool ничего не возвращает, поэтому без очереди - noQueue
+	bool noQueue () { return false; }
+	Delegate<bool ()> startNext = Delegate<bool ()>::from_function<&noQueue>();	// Начинает следующий запрос очереди, false - очередь пуста
 
-	void writeNextByte ();
-	void updateNextByte ();
+	bool writeNextByte ();
+	void start ();
 	void interruptHandler ();
 	void interruptHandler (uint16_t) { interruptHandler(); }
 
+	// Адрес переменной EEMEM в eeprom. Через uintptr_t - на AVR это тот же 16-битный указатель
+	inline uint16_t addressOf (const volatile void* p) { return (uint16_t)(uintptr_t) p; }
+
+	// Доступ к значению Type как к слову, без нарушения strict aliasing
+	typedef uint16_t __attribute__ ((__may_alias__)) Word;
+	typedef uint32_t __attribute__ ((__may_alias__)) DWord;
+
+#ifdef EEPROM_MIRROR
+	uint8_t mirror[EEPROM_MIRROR_SIZE];
+	uint16_t mirrorSize = 0;			// Сколько байт .eeprom скопировано в mirror
+
+	void mirrorLoad ()
+	{
+		uint16_t used = addressOf (&__eeprom_end); // Адрес в eeprom со смещением 0x810000, младшие 16 бит - размер
+		if ( used <= EEPROM_MIRROR_SIZE )
+		{
+			eeprom_read_block (mirror, 0, used);
+			mirrorSize = used;
+		}
+	}
+	bool isMirrored (const volatile void* address, const uint16_t& length)
+	{
+		return addressOf (address) + length <= mirrorSize;
+	}
+	void mirrorWrite (const volatile void* address, const void* from, const uint16_t& length)
+	{
+		if ( isMirrored (address, length) )
+			for (uint16_t i = 0; i < length; ++i)
+				mirror[addressOf (address) + i] = ((const uint8_t*)from)[i];
+	}
+#endif
+
 	class Init
 	{
 	public:
-		Init () { EE_READY_handler = InterruptHandler::from_function<&interruptHandler>(); }
+		Init ()
+		{
+			EE_READY_handler = InterruptHandler::from_function<&interruptHandler>();
+#ifdef EEPROM_MIRROR
+			mirrorLoad ();
+#endif
+		}
 	} init;
 }
 
+#ifdef EEPROM_MIRROR
+// false - .eeprom больше EEPROM_MIRROR_SIZE, чтение идёт из eeprom
+bool eepromIsMirrored ()
+{
+	return EepromStaticPrivate::mirrorSize != 0;
+}
+#endif
+
+// Блокирующая запись участка eeprom в режиме update с обновлением копии в ram (EEPROM_MIRROR)
+void eepromUpdateBlock (void* to, const void* from, const uint16_t& length)
+{
+#ifdef EEPROM_MIRROR
+	EepromStaticPrivate::mirrorWrite (to, from, length);
+#endif
+	eeprom_update_block (from, to, length);
+}
+
 template<typename Type>
 class Eeprom
 {
 public:
-	explicit Eeprom ();
+	explicit Eeprom () {}
 
 	void operator= (const Type& var) volatile
 	{
+#ifdef EEPROM_MIRROR
+		EepromStaticPrivate::mirrorWrite (this, &var, sizeof(Type));
+#endif
 		if ( sizeof(Type) == 1 )
-			eeprom_update_byte( (uint8_t*)(this), var );
-		if ( sizeof(Type) == 2 )
-			eeprom_update_word( (uint16_t*)(this), var );
-		if ( sizeof(Type) == 4 )
-			eeprom_update_dword( (uint32_t*)(this), var );
+			eeprom_update_byte( (uint8_t*)(this), *(const uint8_t*)&var );
+		else if ( sizeof(Type) == 2 )
+			eeprom_update_word( (uint16_t*)(this), *(const EepromStaticPrivate::Word*)&var );
+		else if ( sizeof(Type) == 4 )
+			eeprom_update_dword( (uint32_t*)(this), *(const EepromStaticPrivate::DWord*)&var );
+		else
+			eeprom_update_block( &var, (void*)(this), sizeof(Type) );
 	}
 	void operator= (const Eeprom& var) volatile
 	{
-		if ( sizeof(Type) == 1 )
-			eeprom_update_byte( (uint8_t*)(this), var.var );
-		if ( sizeof(Type) == 2 )
-			eeprom_update_word( (uint16_t*)(this), var.var );
-		if ( sizeof(Type) == 4 )
-			eeprom_update_dword( (uint32_t*)(this), var.var );
+		operator= ( Type(var) );
 	}
 	operator Type () volatile const
 	{
 		Type var;
+#ifdef EEPROM_MIRROR
+		if ( EepromStaticPrivate::isMirrored (this, sizeof(Type)) )
+		{
+			for (uint8_t i = 0; i < sizeof(Type); ++i)
+				((uint8_t*)&var)[i] = EepromStaticPrivate::mirror[EepromStaticPrivate::addressOf (this) + i];
+			return var;
+		}
+#endif
 		if ( sizeof(Type) == 1 )
-			var = eeprom_read_byte( (uint8_t*)(this) );
-		if ( sizeof(Type) == 2 )
-			var = eeprom_read_word( (uint16_t*)(this) );
-		if ( sizeof(Type) == 4 )
-			var = eeprom_read_dword( (uint32_t*)(this) );
+			*(uint8_t*)&var = eeprom_read_byte( (uint8_t*)(this) );
+		else if ( sizeof(Type) == 2 )
+			*(EepromStaticPrivate::Word*)&var = eeprom_read_word( (uint16_t*)(this) );
+		else if ( sizeof(Type) == 4 )
+			*(EepromStaticPrivate::DWord*)&var = eeprom_read_dword( (uint32_t*)(this) );
+		else
+			eeprom_read_block( &var, (const void*)(this), sizeof(Type) );
 		return var;
 	}
 
 	bool writeUnblock( const Type& var, const SoftIntHandler& runAfterWriteEnd = SoftIntHandler(), const bool& updateMode = false );
 	bool updateUnblock( const Type& var, const SoftIntHandler& runAfterWriteEnd = SoftIntHandler() );
-	bool isReady () volatile const { return EepromStaticPrivate::byteNumber == 0 && !reg.eepromControl && !(reg.pgmStore & 1); }
+	bool isReady () volatile const { return !EepromStaticPrivate::active && !reg.eepromControl && !(reg.pgmStore & 1); }
 
 private:
 	Type var;
 };
 
 
-template<typename Type>
-Eeprom<Type>::Eeprom ()
-{
-	static_assert ( sizeof(Type)==1 || sizeof(Type)==2 || sizeof(Type)==4,
-					"Unsupported type");
-}
-
 template<typename Type>
 bool Eeprom<Type>::writeUnblock(const Type& var, const SoftIntHandler& runAfterWriteEnd, const bool& updateMode )
 {
+	static_assert ( sizeof(Type) <= 4, "writeUnblock copies value into 4 byte buffer. Use EepromQueue for bigger types" );
+
 	volatile uint8_t sreg = reg.status;
 	cli ();
-	if ( EepromStaticPrivate::byteNumber == 0  ) // no active write
+	PROFILE_ENTER(CriticalProfile::eepromWrite);
+	if ( !EepromStaticPrivate::active ) // no active write
 	{
-		EepromStaticPrivate::byteNumber = sizeof(Type);
+		EepromStaticPrivate::active = true;
+		PROFILE_EXIT(CriticalProfile::eepromWrite);
 		reg.status = sreg;
 
+		for (uint8_t i = 0; i < sizeof(Type); ++i)
+			EepromStaticPrivate::writingVar[i] = ((const uint8_t*)&var)[i];
 		EepromStaticPrivate::updateMode = updateMode;
-		EepromStaticPrivate::writingVar = (uint32_t) var;
+		EepromStaticPrivate::source = &EepromStaticPrivate::writingVar[0];
 		EepromStaticPrivate::startAddress = (uint8_t *)this;
-		EepromStaticPrivate::afterWrite = runAfterWriteEnd;
+		EepromStaticPrivate::byteNumber = sizeof(Type);
+		EepromStaticPrivate::afterWrite = {runAfterWriteEnd, EepromStaticPrivate::addressOf (this)};
 
 		cli();
+		PROFILE_ENTER(CriticalProfile::eepromWrite);
 		if ( !reg.eepromControl && !(reg.pgmStore & 1) ) // no flag in eepromControl
 		{
-			EepromStaticPrivate::writeNextByte();
+#ifdef EEPROM_MIRROR
+			EepromStaticPrivate::mirrorWrite (this, &var, sizeof(Type));
+#endif
+			EepromStaticPrivate::start();
+			PROFILE_EXIT(CriticalProfile::eepromWrite);
 			reg.status = sreg;
 			return true;
 		}
 		else
 		{
-			EepromStaticPrivate::byteNumber = 0; // free
+			// Освобождение через прерывание: за время без cli в очередь мог быть добавлен запрос
+			EepromStaticPrivate::byteNumber = 0;
+			EepromStaticPrivate::afterWrite = Command();
+			EepromStaticPrivate::start();
+			PROFILE_EXIT(CriticalProfile::eepromWrite);
 			reg.status = sreg;
 			return false;
 		}
 	}
 	else
 	{
+		PROFILE_EXIT(CriticalProfile::eepromWrite);
 		reg.status = sreg;
 		return false;
 	}
@@ -210,54 +342,121 @@ bool Eeprom<Type>::updateUnblock(const Type& var, const SoftIntHandler& runAfter
 	return writeUnblock( var, runAfterWriteEnd, true );
 }
 
-namespace EepromStaticPrivate
+
+template<uint8_t size>
+class EepromQueue
 {
-	void writeNextByte ()
+public:
+	EepromQueue ()
+		: head (0), tail (0), count (0), previous (EepromStaticPrivate::startNext)
 	{
-		uint8_t num = --byteNumber;
-		reg.eepromAddress = startAddress+num;
+		EepromStaticPrivate::startNext = Delegate<bool ()>::from_method<EepromQueue, &EepromQueue::startNext>(this);
+	}
 
-		Bitfield<EepromControl> ctr (0);
-		if (updateMode)
+	// Запись произвольного количества байт. Буфер from должен оставаться неизменным до выполнения done.
+	bool write (void* to, const void* from, const uint16_t& length, const Command& done = Command(), const bool& updateMode = false)
+	{
+		bool added = false;
+		PROFILE_ATOMIC(CriticalProfile::eepromWrite)
 		{
-			// Read before write
-			ctr.readEnable = true;
-			reg.eepromControl = ctr;
-
-			if (reg.eepromData == writingVar[num])
+			if ( count != size )
 			{
-				interruptHandler();
-				return;
+				request[tail] = { (uint8_t*)to, (const uint8_t*)from, length, updateMode, done };
+				if ( ++tail == size )
+					tail = 0;
+				count ++;
+				added = true;
+
+				if ( !EepromStaticPrivate::active )
+				{
+					EepromStaticPrivate::active = true;
+					EepromStaticPrivate::byteNumber = 0;
+					EepromStaticPrivate::afterWrite = Command();
+					EepromStaticPrivate::start();
+				}
 			}
 		}
-		reg.eepromData = writingVar[num];
-
-		ctr.readEnable = false;
-		ctr.writeEnable = false;
-		ctr.masterWriteEnable = true;
-		ctr.interruptEnable = true;
-		reg.eepromControl = ctr; // Prepare
+#ifdef EEPROM_MIRROR
+		if ( added )
+			EepromStaticPrivate::mirrorWrite (to, from, length);
+#endif
+		return added;
+	}
+	bool update (void* to, const void* from, const uint16_t& length, const Command& done = Command())
+	{
+		return write (to, from, length, done, true);
+	}
 
-		ctr.readEnable = false;
-		ctr.writeEnable = true;
-		ctr.masterWriteEnable = true;
-		ctr.interruptEnable = true;
-		reg.eepromControl = ctr; // Start!
+	template<typename Type>
+	bool write (Eeprom<Type>& to, const Type& from, const Command& done = Command())
+	{
+		return write (&to, &from, sizeof(Type), done);
 	}
+	template<typename Type>
+	bool update (Eeprom<Type>& to, const Type& from, const Command& done = Command())
+	{
+		return write (&to, &from, sizeof(Type), done, true);
+	}
+
+	uint8_t getCount () const { return count; }
 
-	void updateNextByte ()
+private:
+	struct Request
+	{
+		uint8_t* to;
+		const uint8_t* from;
+		uint16_t length;
+		bool updateMode;
+		Command done;
+	};
+
+	Request request[size];
+	uint8_t head;
+	uint8_t tail;
+	volatile uint8_t count;
+	Delegate<bool ()> previous;		// Очередь, созданная раньше этой
+
+	// Вызывается из прерывания EE_READY
+	bool startNext ()
 	{
-		uint8_t num = --byteNumber;
-		reg.eepromAddress = startAddress+num;
+		if ( count == 0 )
+			return previous ();
+
+		Request& r = request[head];
+		EepromStaticPrivate::startAddress = r.to;
+		EepromStaticPrivate::source = r.from;
+		EepromStaticPrivate::byteNumber = r.length;
+		EepromStaticPrivate::updateMode = r.updateMode;
+		EepromStaticPrivate::afterWrite = r.done;
+		if ( ++head == size )
+			head = 0;
+		count --;
+		return true;
+	}
+};
 
-		// Read before write
-		Bitfield<EepromControl> ctr (0);
-		ctr.readEnable = true;
-		reg.eepromControl = ctr;
 
-		if (reg.eepromData != writingVar[num])
+namespace EepromStaticPrivate
+{
+	// Запускает запись очередного байта текущего запроса. false - запрос закончен.
+	bool writeNextByte ()
+	{
+		Bitfield<EepromControl> ctr (0);
+		while ( byteNumber != 0 )
 		{
-			reg.eepromData = writingVar[num];
+			uint16_t num = --byteNumber;
+			reg.eepromAddress = startAddress+num;
+
+			if (updateMode)
+			{
+				// Read before write
+				ctr.readEnable = true;
+				reg.eepromControl = ctr;
+
+				if (reg.eepromData == source[num])
+					continue;
+			}
+			reg.eepromData = source[num];
 
 			ctr.readEnable = false;
 			ctr.writeEnable = false;
@@ -270,21 +469,36 @@ namespace EepromStaticPrivate
 			ctr.masterWriteEnable = true;
 			ctr.interruptEnable = true;
 			reg.eepromControl = ctr; // Start!
+			return true;
 		}
-		else
-			interruptHandler();
+		return false;
+	}
+
+	// Первый байт пишется из прерывания, которое возникнет сразу по готовности eeprom
+	void start ()
+	{
+		Bitfield<EepromControl> ctr (0);
+		ctr.interruptEnable = true;
+		reg.eepromControl = ctr;
 	}
 
 	void interruptHandler ()
 	{
-		if ( byteNumber != 0 )
-			writeNextByte();
-		else
 		{
-			reg.eepromControl = 0;
-			sei ();
-			if ( afterWrite )
-				dispatcher.add( afterWrite, (uint16_t)startAddress );
+			PROFILE_SCOPE(CriticalProfile::eepromInterrupt);
+			while ( !writeNextByte() ) // Текущий запрос закончен
+			{
+				if ( afterWrite.handler )
+					dispatcher.add( afterWrite );
+				afterWrite = Command();
+
+				if ( !startNext() )
+				{
+					reg.eepromControl = 0;
+					active = false;
+					break;
+				}
+			}
 		}
 		sei ();
 	}
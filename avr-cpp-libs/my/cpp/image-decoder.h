@@ -0,0 +1,281 @@
+/*
+ * image-decoder.h
+ *
+ * Потоковый разбор образа прошивки (Intel HEX или двоичный)
+ * *********************************************************
+ *
+ *  ~~~ Проблема: ~~~
+ *  Чтобы перешить соседа, образ приходится заранее вручную переводить в двоичный вид и разбивать на страницы.
+ *  Образ приходит по частям (USART, многокадровые сообщения CAN) и целиком в ram не помещается.
+ *
+ *  ~~~ Решение: ~~~
+ *  1. Байты образа подаются по одному (или кусками) в put(). Разбор Intel HEX идёт конечным автоматом
+ *     по символам, запись целиком не хранится. Поддерживаются записи 00 (данные), 01 (конец),
+ *     02 и 04 (расширенный адрес), 03 и 05 (адрес старта - пропускаются).
+ *  2. Данные собираются в буфер одной страницы. Как только очередной байт попадает в другую страницу
+ *     (или пришёл конец образа), накопленная страница отдаётся делегату page (address, data, pageSize).
+ *     Не заполненные образом байты страницы равны 0xFF - для flash это "не программировать".
+ *  3. Данные записи копятся в буфере записи (до 255 байт) и укладываются в страницу только после проверки
+ *     её контрольной суммы, поэтому испорченная запись не попадает в page. При ошибке put() возвращает error,
+ *     и все следующие вызовы тоже.
+ *  4. Для двоичного образа байты просто укладываются подряд начиная с base, последняя страница отдаётся в finish().
+ *
+ *  ~~~ Интерфейс: ~~~
+ *  ImageDecoder<pageSize> decoder (page, format, base);
+ *  - page - Delegate<void (uint32_t address, const uint8_t* data, uint16_t length)>
+ *  - format - ImageDecoder<>::hex (по умолчанию) или ImageDecoder<>::binary
+ *  - base - начальный адрес двоичного образа
+ *  decoder.put (c);				// ok, end (получена запись 01) или error
+ *  decoder.put (data, length);
+ *  decoder.finish ();			// Отдать последнюю страницу. Для hex без записи 01 - error
+ *  decoder.getPageCount ();		// Число отданных страниц
+ *
+ *  ~~~ Ограничения: ~~~
+ *  1. pageSize - степень двойки. Он не обязан совпадать со страницей микросхемы: ProgSpiSimple::writePage
+ *     сам делит блок по страницам микросхемы. Но pageSize меньше страницы микросхемы
+ *     означает несколько записей одной страницы flash, поэтому обычно берётся FLASH_PAGE_SIZE (256) -
+ *     наибольшая страница в таблице ProgSpi::devices.
+ *  2. Записи внутри страницы должны идти по возрастанию адресов (так пишут avr-objcopy и IDE).
+ *     Если образ вернётся в уже отданную страницу, то она будет отдана ещё раз, остальные байты в ней будут 0xFF.
+ *  3. Страницы, отданные до error, верны, но образ записан не весь: прошивку соседа нужно повторить с начала.
+ *  4. Делегат вызывается из put(). Буфер страницы действителен только до возврата из делегата.
+ *  5. ram: страница (pageSize) и запись (255 байт).
+ *
+ *  ~~~ Пример использования: ~~~
+	using namespace ProgSpi;
+	typedef ProgSpiSimple<&Register::spiStatusControl, &Register::spiData, &Register::portB, 0, 1, 2, 3, &Register::portE, 4> Neighbour;
+	Neighbour neighbour;
+
+	// Страница декодера 256 байт, writePage разбивает её на страницы соседа (64, 128 или 256 байт)
+	ImageDecoder<FLASH_PAGE_SIZE> decoder (
+		ImageDecoder<FLASH_PAGE_SIZE>::PageHandler::from_method<Neighbour, &Neighbour::writePage<flash> >(&neighbour) );
+
+	void receive (uint8_t c)	// Байт, принятый от компьютера
+	{
+		if ( decoder.put (c) != ImageDecoder<FLASH_PAGE_SIZE>::ok )
+			neighbour.rebootInWork ();
+	}
+ *
+ */
+
+#ifndef IMAGE_DECODER_H_
+#define IMAGE_DECODER_H_
+
+#include <string.h>
+#include <cpp/universal.h>
+#include <cpp/delegate/delegate.hpp>
+
+template <uint16_t pageSize>
+class ImageDecoder
+{
+public:
+	typedef Delegate<void (uint32_t, const uint8_t*, uint16_t)> PageHandler;
+
+	enum Format : uint8_t
+	{
+		hex,
+		binary
+	};
+	enum Status : uint8_t
+	{
+		ok,
+		end,
+		error
+	};
+
+	ImageDecoder (const PageHandler& page_, Format format_ = hex, uint32_t base_ = 0)
+		: page (page_), format (format_), state (format_ == hex ? colon : data), half (false),
+		  base (base_), pageUsed (false), pageCount (0)
+	{
+		static_assert ( pageSize != 0 && (pageSize & (pageSize - 1)) == 0, "pageSize must be a power of 2" );
+	}
+
+	Status put (uint8_t c)
+	{
+		if ( state == failed )
+			return error;
+		if ( state == finished )
+			return end;
+
+		if ( format == binary )
+		{
+			store (base ++, c);
+			return ok;
+		}
+
+		if ( state == colon )
+		{
+			if ( c == ':' )
+			{
+				state = count;
+				sum = 0;
+				half = false;
+				return ok;
+			}
+			if ( c == '\r' || c == '\n' || c == ' ' || c == '\t' )
+				return ok;
+			return fail ();
+		}
+
+		uint8_t digit;
+		if ( c >= '0' && c <= '9' )
+			digit = c - '0';
+		else if ( c >= 'A' && c <= 'F' )
+			digit = c - 'A' + 10;
+		else if ( c >= 'a' && c <= 'f' )
+			digit = c - 'a' + 10;
+		else
+			return fail ();
+
+		if ( !half )
+		{
+			value = digit << 4;
+			half = true;
+			return ok;
+		}
+		half = false;
+		value |= digit;
+		sum += value;
+		return record (value);
+	}
+
+	Status put (const uint8_t* data, uint16_t length)
+	{
+		Status s = ok;
+		while ( length-- && (s = put (*data++)) == ok );
+		return s;
+	}
+
+	Status finish ()
+	{
+		if ( state == failed )
+			return error;
+		flush ();
+		if ( format == hex && state != finished )
+			return fail ();
+		state = finished;
+		return end;
+	}
+
+	uint16_t getPageCount () const { return pageCount; }
+
+private:
+	enum State : uint8_t
+	{
+		colon,
+		count,
+		addressHigh,
+		addressLow,
+		type,
+		data,
+		checksum,
+		finished,
+		failed
+	};
+
+	PageHandler page;
+	Format format;
+	State state;
+	bool half;					// Принят старший полубайт
+	uint8_t value;
+	uint8_t sum;
+	uint8_t recordLength;
+	uint8_t recordType;
+	uint8_t recordIndex;
+	uint16_t recordAddress;
+	uint16_t extended;			// Поле записей 02 и 04
+	uint32_t base;				// Адрес, добавляемый к адресу записи (для binary - адрес следующего байта)
+	uint32_t pageAddress;
+	bool pageUsed;
+	uint16_t pageCount;
+	uint8_t buffer[pageSize];
+	uint8_t recordData[255];		// Данные записи до проверки контрольной суммы
+
+	Status record (uint8_t b)
+	{
+		switch (state)
+		{
+		case count:
+			recordLength = b;
+			state = addressHigh;
+			break;
+		case addressHigh:
+			recordAddress = b << 8;
+			state = addressLow;
+			break;
+		case addressLow:
+			recordAddress |= b;
+			state = type;
+			break;
+		case type:
+			if ( b > 5 )
+				return fail ();
+			recordType = b;
+			recordIndex = 0;
+			extended = 0;
+			state = recordLength ? data : checksum;
+			break;
+		case data:
+			if ( recordType == 0 )
+				recordData[recordIndex] = b;
+			else
+				extended = (extended << 8) | b;
+			if ( ++recordIndex == recordLength )
+				state = checksum;
+			break;
+		case checksum:
+			if ( sum != 0 )
+				return fail ();
+			state = colon;
+			if ( recordType == 0 )
+				for (uint8_t i = 0; i < recordLength; ++i)
+					store (base + recordAddress + i, recordData[i]);
+			if ( recordType == 1 )
+			{
+				flush ();
+				state = finished;
+				return end;
+			}
+			if ( recordType == 2 )
+				base = uint32_t(extended) << 4;
+			if ( recordType == 4 )
+				base = uint32_t(extended) << 16;
+			break;
+		default:
+			break;
+		}
+		return ok;
+	}
+
+	void store (uint32_t address, uint8_t b)
+	{
+		uint32_t start = address & ~uint32_t(pageSize - 1);
+		if ( pageUsed && start != pageAddress )
+			flush ();
+		if ( !pageUsed )
+		{
+			memset (buffer, 0xFF, pageSize);
+			pageAddress = start;
+			pageUsed = true;
+		}
+		buffer[address & (pageSize - 1)] = b;
+	}
+
+	void flush ()
+	{
+		if ( pageUsed )
+		{
+			pageUsed = false;
+			pageCount ++;
+			page (pageAddress, buffer, pageSize);
+		}
+	}
+
+	Status fail ()
+	{
+		state = failed;
+		return error;
+	}
+};
+
+#endif /* IMAGE_DECODER_H_ */
@@ -31,6 +31,16 @@
  *  -        signal
  *           NAME_handler  ,      
  *
+ *  INTERRUPT_DYNAMIC_SELECTIVE
+ *  -       ,         ,
+ *       ,    INTERRUPT_DYNAMIC_NAME (. INTERRUPT_DYNAMIC_TIMER1_COMPA).
+ *           (__bad_interrupt  avr-libc).
+ *  -   : Alarm0/2/1A/3A - TIMERn_COMP(A), Eeprom - EE_READY, CanDat - CANIT, ProgSpiAsync - SPI_STC,
+ *    Usart - USARTn_RX  USARTn_UDRE, SpiMaster - SPI_STC.
+ *       .  ,      NAME_handler.
+ *  -     105  flash  4  ram (3,8   136   36 ).
+ *    ,  5 ,   0,5  flash  20  ram.
+ *
  *
  *  ~~~ : ~~~
  *  1.   ,         ,
@@ -91,6 +101,14 @@
 	//  ...
 	Cl obj; //  
 	INT2_handler = InterruptHandler::from_method<Cl,&Cl::cfunc> (&obj);
+
+
+	//    (    )
+	#define INTERRUPT_DYNAMIC_SELECTIVE
+	#define INTERRUPT_DYNAMIC_TIMER1_COMPA
+	#define INTERRUPT_DYNAMIC_CANIT
+	#define INTERRUPT_DYNAMIC_EE_READY
+	#include <cpp/can-dat.h>
  *
  */
 
@@ -137,150 +155,151 @@ typedef Delegate<void ()> InterruptHandler;
 // ------------------------------- TERRIBLE OVERHEAD HERE -----------------------------------------
 // ------------------------------------------------------------------------------------------------
 //   (!)      .
+// (   INTERRUPT_DYNAMIC_SELECTIVE, .  )
 //     3,8      flash!
 //			     136     ram!
 
-#ifdef INT0_vect
+#if defined (INT0_vect) && ( !defined (INTERRUPT_DYNAMIC_SELECTIVE) || defined (INTERRUPT_DYNAMIC_INT0) )
 INTERRUPT_POINTER_DECLARE(INT0)
 #endif
 
-#ifdef INT1_vect
+#if defined (INT1_vect) && ( !defined (INTERRUPT_DYNAMIC_SELECTIVE) || defined (INTERRUPT_DYNAMIC_INT1) )
 INTERRUPT_POINTER_DECLARE(INT1)
 #endif
 
-#ifdef INT2_vect
+#if defined (INT2_vect) && ( !defined (INTERRUPT_DYNAMIC_SELECTIVE) || defined (INTERRUPT_DYNAMIC_INT2) )
 INTERRUPT_POINTER_DECLARE(INT2)
 #endif
 
-#ifdef INT3_vect
+#if defined (INT3_vect) && ( !defined (INTERRUPT_DYNAMIC_SELECTIVE) || defined (INTERRUPT_DYNAMIC_INT3) )
 INTERRUPT_POINTER_DECLARE(INT3)
 #endif
 
-#ifdef INT4_vect
+#if defined (INT4_vect) && ( !defined (INTERRUPT_DYNAMIC_SELECTIVE) || defined (INTERRUPT_DYNAMIC_INT4) )
 INTERRUPT_POINTER_DECLARE(INT4)
 #endif
 
-#ifdef INT5_vect
+#if defined (INT5_vect) && ( !defined (INTERRUPT_DYNAMIC_SELECTIVE) || defined (INTERRUPT_DYNAMIC_INT5) )
 INTERRUPT_POINTER_DECLARE(INT5)
 #endif
 
-#ifdef INT6_vect
+#if defined (INT6_vect) && ( !defined (INTERRUPT_DYNAMIC_SELECTIVE) || defined (INTERRUPT_DYNAMIC_INT6) )
 INTERRUPT_POINTER_DECLARE(INT6)
 #endif
 
-#ifdef INT7_vect
+#if defined (INT7_vect) && ( !defined (INTERRUPT_DYNAMIC_SELECTIVE) || defined (INTERRUPT_DYNAMIC_INT7) )
 INTERRUPT_POINTER_DECLARE(INT7)
 #endif
 
-#ifdef TIMER2_COMP_vect
+#if defined (TIMER2_COMP_vect) && ( !defined (INTERRUPT_DYNAMIC_SELECTIVE) || defined (INTERRUPT_DYNAMIC_TIMER2_COMP) )
 INTERRUPT_POINTER_DECLARE(TIMER2_COMP)
 #endif
 
-#ifdef TIMER2_OVF_vect
+#if defined (TIMER2_OVF_vect) && ( !defined (INTERRUPT_DYNAMIC_SELECTIVE) || defined (INTERRUPT_DYNAMIC_TIMER2_OVF) )
 INTERRUPT_POINTER_DECLARE(TIMER2_OVF)
 #endif
 
-#ifdef TIMER1_CAPT_vect
+#if defined (TIMER1_CAPT_vect) && ( !defined (INTERRUPT_DYNAMIC_SELECTIVE) || defined (INTERRUPT_DYNAMIC_TIMER1_CAPT) )
 INTERRUPT_POINTER_DECLARE(TIMER1_CAPT)
 #endif
 
-#ifdef TIMER1_COMPA_vect
+#if defined (TIMER1_COMPA_vect) && ( !defined (INTERRUPT_DYNAMIC_SELECTIVE) || defined (INTERRUPT_DYNAMIC_TIMER1_COMPA) )
 INTERRUPT_POINTER_DECLARE(TIMER1_COMPA)
 #endif
 
-#ifdef TIMER1_COMPB_vect
+#if defined (TIMER1_COMPB_vect) && ( !defined (INTERRUPT_DYNAMIC_SELECTIVE) || defined (INTERRUPT_DYNAMIC_TIMER1_COMPB) )
 INTERRUPT_POINTER_DECLARE(TIMER1_COMPB)
 #endif
 
-#ifdef TIMER1_COMPC_vect
+#if defined (TIMER1_COMPC_vect) && ( !defined (INTERRUPT_DYNAMIC_SELECTIVE) || defined (INTERRUPT_DYNAMIC_TIMER1_COMPC) )
 INTERRUPT_POINTER_DECLARE(TIMER1_COMPC)
 #endif
 
-#ifdef TIMER1_OVF_vect
+#if defined (TIMER1_OVF_vect) && ( !defined (INTERRUPT_DYNAMIC_SELECTIVE) || defined (INTERRUPT_DYNAMIC_TIMER1_OVF) )
 INTERRUPT_POINTER_DECLARE(TIMER1_OVF)
 #endif
 
-#ifdef TIMER0_COMP_vect
+#if defined (TIMER0_COMP_vect) && ( !defined (INTERRUPT_DYNAMIC_SELECTIVE) || defined (INTERRUPT_DYNAMIC_TIMER0_COMP) )
 INTERRUPT_POINTER_DECLARE(TIMER0_COMP)
 #endif
 
-#ifdef TIMER0_OVF_vect
+#if defined (TIMER0_OVF_vect) && ( !defined (INTERRUPT_DYNAMIC_SELECTIVE) || defined (INTERRUPT_DYNAMIC_TIMER0_OVF) )
 INTERRUPT_POINTER_DECLARE(TIMER0_OVF)
 #endif
 
-#ifdef CANIT_vect
+#if defined (CANIT_vect) && ( !defined (INTERRUPT_DYNAMIC_SELECTIVE) || defined (INTERRUPT_DYNAMIC_CANIT) )
 INTERRUPT_POINTER_DECLARE(CANIT)
 #endif
 
-#ifdef OVRIT_vect
+#if defined (OVRIT_vect) && ( !defined (INTERRUPT_DYNAMIC_SELECTIVE) || defined (INTERRUPT_DYNAMIC_OVRIT) )
 INTERRUPT_POINTER_DECLARE(OVRIT)
 #endif
 
-#ifdef SPI_STC_vect
+#if defined (SPI_STC_vect) && ( !defined (INTERRUPT_DYNAMIC_SELECTIVE) || defined (INTERRUPT_DYNAMIC_SPI_STC) )
 INTERRUPT_POINTER_DECLARE(SPI_STC)
 #endif
 
-#ifdef USART0_RX_vect
+#if defined (USART0_RX_vect) && ( !defined (INTERRUPT_DYNAMIC_SELECTIVE) || defined (INTERRUPT_DYNAMIC_USART0_RX) )
 INTERRUPT_POINTER_DECLARE(USART0_RX)
 #endif
 
-#ifdef USART0_UDRE_vect
+#if defined (USART0_UDRE_vect) && ( !defined (INTERRUPT_DYNAMIC_SELECTIVE) || defined (INTERRUPT_DYNAMIC_USART0_UDRE) )
 INTERRUPT_POINTER_DECLARE(USART0_UDRE)
 #endif
 
-#ifdef USART0_TX_vect
+#if defined (USART0_TX_vect) && ( !defined (INTERRUPT_DYNAMIC_SELECTIVE) || defined (INTERRUPT_DYNAMIC_USART0_TX) )
 INTERRUPT_POINTER_DECLARE(USART0_TX)
 #endif
 
-#ifdef ANALOG_COMP_vect
+#if defined (ANALOG_COMP_vect) && ( !defined (INTERRUPT_DYNAMIC_SELECTIVE) || defined (INTERRUPT_DYNAMIC_ANALOG_COMP) )
 INTERRUPT_POINTER_DECLARE(ANALOG_COMP)
 #endif
 
-#ifdef ADC_vect
+#if defined (ADC_vect) && ( !defined (INTERRUPT_DYNAMIC_SELECTIVE) || defined (INTERRUPT_DYNAMIC_ADC) )
 INTERRUPT_POINTER_DECLARE(ADC)
 #endif
 
-#ifdef EE_READY_vect
+#if defined (EE_READY_vect) && ( !defined (INTERRUPT_DYNAMIC_SELECTIVE) || defined (INTERRUPT_DYNAMIC_EE_READY) )
 INTERRUPT_POINTER_DECLARE(EE_READY)
 #endif
 
-#ifdef TIMER3_CAPT_vect
+#if defined (TIMER3_CAPT_vect) && ( !defined (INTERRUPT_DYNAMIC_SELECTIVE) || defined (INTERRUPT_DYNAMIC_TIMER3_CAPT) )
 INTERRUPT_POINTER_DECLARE(TIMER3_CAPT)
 #endif
 
-#ifdef TIMER3_COMPA_vect
+#if defined (TIMER3_COMPA_vect) && ( !defined (INTERRUPT_DYNAMIC_SELECTIVE) || defined (INTERRUPT_DYNAMIC_TIMER3_COMPA) )
 INTERRUPT_POINTER_DECLARE(TIMER3_COMPA)
 #endif
 
-#ifdef TIMER3_COMPB_vect
+#if defined (TIMER3_COMPB_vect) && ( !defined (INTERRUPT_DYNAMIC_SELECTIVE) || defined (INTERRUPT_DYNAMIC_TIMER3_COMPB) )
 INTERRUPT_POINTER_DECLARE(TIMER3_COMPB)
 #endif
 
-#ifdef TIMER3_COMPC_vect
+#if defined (TIMER3_COMPC_vect) && ( !defined (INTERRUPT_DYNAMIC_SELECTIVE) || defined (INTERRUPT_DYNAMIC_TIMER3_COMPC) )
 INTERRUPT_POINTER_DECLARE(TIMER3_COMPC)
 #endif
 
-#ifdef TIMER3_OVF_vect
+#if defined (TIMER3_OVF_vect) && ( !defined (INTERRUPT_DYNAMIC_SELECTIVE) || defined (INTERRUPT_DYNAMIC_TIMER3_OVF) )
 INTERRUPT_POINTER_DECLARE(TIMER3_OVF)
 #endif
 
-#ifdef USART1_RX_vect
+#if defined (USART1_RX_vect) && ( !defined (INTERRUPT_DYNAMIC_SELECTIVE) || defined (INTERRUPT_DYNAMIC_USART1_RX) )
 INTERRUPT_POINTER_DECLARE(USART1_RX)
 #endif
 
-#ifdef USART1_UDRE_vect
+#if defined (USART1_UDRE_vect) && ( !defined (INTERRUPT_DYNAMIC_SELECTIVE) || defined (INTERRUPT_DYNAMIC_USART1_UDRE) )
 INTERRUPT_POINTER_DECLARE(USART1_UDRE)
 #endif
 
-#ifdef USART1_TX_vect
+#if defined (USART1_TX_vect) && ( !defined (INTERRUPT_DYNAMIC_SELECTIVE) || defined (INTERRUPT_DYNAMIC_USART1_TX) )
 INTERRUPT_POINTER_DECLARE(USART1_TX)
 #endif
 
-#ifdef TWI_vect
+#if defined (TWI_vect) && ( !defined (INTERRUPT_DYNAMIC_SELECTIVE) || defined (INTERRUPT_DYNAMIC_TWI) )
 INTERRUPT_POINTER_DECLARE(TWI)
 #endif
 
-#ifdef SPM_READY_vect
+#if defined (SPM_READY_vect) && ( !defined (INTERRUPT_DYNAMIC_SELECTIVE) || defined (INTERRUPT_DYNAMIC_SPM_READY) )
 INTERRUPT_POINTER_DECLARE(SPM_READY)
 #endif
 
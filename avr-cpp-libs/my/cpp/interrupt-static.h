@@ -0,0 +1,80 @@
+/*
+ * interrupt-static.h
+ *
+ * Статическая привязка обработчиков прерываний к методам объектов
+ * ***************************************************************
+ *
+ *  ~~~ Проблема: ~~~
+ *  Прерывание из interrupt-dynamic.h вызывает обработчик через делегат (по указателю).
+ *  Не зная, какая функция будет вызвана, компилятор сохраняет в векторе все зарезервированные регистры
+ *  (r18-r27, r30, r31 - 12 штук) плюс r0, r1 и SREG. Для Clock::incTime, где работы на десяток команд,
+ *  вход и выход из прерывания обходятся дороже самой работы.
+ *
+ *  ~~~ Задача: ~~~
+ *  Если обработчик прерывания известен на этапе компиляции и не меняется во время работы,
+ *  то встроить его тело прямо в вектор прерывания.
+ *
+ *  ~~~ Решение: ~~~
+ *  1. Вектор NAME_vect объявляется напрямую с аттрибутом signal и вызывает метод глобального объекта.
+ *     Объект и метод известны компилятору, поэтому вызов встраивается (аттрибут flatten встраивает и
+ *     все вложенные вызовы), а в прологе сохраняются только реально используемые регистры.
+ *  2. Модули библиотеки (Alarm, CanDat) записывают свой делегат в NAME_handler.
+ *     Чтобы их не переделывать, для статического вектора объявляется NAME_handler-заглушка,
+ *     которая никогда не вызывается (4 байта ram).
+ *
+ *  ~~~ Интерфейс: ~~~
+ *  INTERRUPT_STATIC_DECLARE(NAME)
+ *  - Объявляет заглушку NAME_handler. Должен стоять до подключения заголовков модулей, которые её используют
+ *    (CanDat обращается к CANIT_handler в теле шаблона, Alarm1A получает адрес TIMER1_COMPA_handler параметром).
+ *
+ *  INTERRUPT_STATIC(NAME, object, method)
+ *  - Создаёт обработчик прерывания NAME_vect, который вызывает object.method ().
+ *    Метод должен быть открытым. Стоит после объявления объекта.
+ *
+ *  ~~~ Ограничения: ~~~
+ *  1. Обработчик нельзя сменить во время работы (newInterruptHandler у Alarm ни на что не влияет).
+ *  2. interrupt-dynamic.h не должен объявлять этот же вектор, иначе компилятор сообщит о повторном
+ *     определении NAME_handler. Поэтому используется вместе с INTERRUPT_DYNAMIC_SELECTIVE,
+ *     а вектор в INTERRUPT_DYNAMIC_NAME не перечисляется.
+ *  3. Flatten встраивает все вызовы из метода. Для больших обработчиков (CanDat) это увеличивает flash,
+ *     зато вызовы внутри прерывания также перестают сохранять регистры.
+ *
+ *  ~~~ Комментарии: ~~~
+ *  Для делегата к затратам на регистры добавляются загрузка указателя, icall и ret - около 50 тактов
+ *  на каждое прерывание против 10-20 тактов у статического вектора с небольшим обработчиком.
+ *
+ *  ~~~ Пример использования: ~~~
+	#define INTERRUPT_DYNAMIC_SELECTIVE
+	#define INTERRUPT_DYNAMIC_EE_READY			// Остальные модули остаются динамическими
+	#include <cpp/interrupt-static.h>
+
+	INTERRUPT_STATIC_DECLARE (TIMER1_COMPA);
+	INTERRUPT_STATIC_DECLARE (CANIT);
+
+	#include <cpp/timers.h>
+	#include <cpp/can-dat.h>
+
+	Clock< Alarm<Alarm1A, 1000> > clock;
+	CanDat<...> canDat;
+
+	INTERRUPT_STATIC (TIMER1_COMPA, clock, incTime);
+	INTERRUPT_STATIC (CANIT, canDat, interruptHandler);
+ *
+ */
+
+#ifndef INTERRUPT_STATIC_H_
+#define INTERRUPT_STATIC_H_
+
+#include <cpp/interrupt-dynamic.h>
+
+#define INTERRUPT_STATIC_DECLARE(NAME_without_vect)\
+	InterruptHandler NAME_without_vect ## _handler
+
+#define INTERRUPT_STATIC(NAME_without_vect, object, method)\
+	extern "C" void NAME_without_vect ## _vect (void) __attribute__ ((signal, used, externally_visible, flatten));\
+	void NAME_without_vect ## _vect (void)\
+	{\
+		object.method ();\
+	}
+
+#endif /* INTERRUPT_STATIC_H_ */
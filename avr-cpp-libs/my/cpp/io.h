@@ -92,7 +92,7 @@ public:
 	{
 		port_ = (uint8_t) p;
 	}
-	inline operator volatile uint8_t() const
+	inline operator uint8_t() const
 	{
 		return pin_;
 	}
@@ -108,6 +108,36 @@ public:
 	{
 		pin_ = 0xff;
 	}
+	// Групповые операции: меняются только пины из mask, за одну запись в регистр
+	inline void set (uint8_t mask)
+	{
+		port_ |= mask;
+	}
+	inline void clear (uint8_t mask)
+	{
+		port_ &= ~mask;
+	}
+	inline void write (uint8_t mask, uint8_t value)
+	{
+		port_ = (port_ & ~mask) | (value & mask);
+	}
+	inline void toggle (uint8_t mask)
+	{
+		pin_ = mask;
+	}
+	inline void in (uint8_t mask)
+	{
+		dir_ &= ~mask;
+	}
+	inline void inPulled (uint8_t mask)
+	{
+		dir_ &= ~mask;
+		port_ |= mask;
+	}
+	inline void out (uint8_t mask)
+	{
+		dir_ |= mask;
+	}
 	template<uint8_t pinN>
 	Pin<pinN>& pin ()
 	{ return (*(Pin<pinN>*)this); }
@@ -138,6 +168,11 @@ template <typename Type, uint8_t size = sizeof(Type)> struct TypeSelect;
 // Для имеющиейся структуры с битовыми полями Bit
 // предосталяет доступ как к целому
 // также сохраняя доступ к элементам через оператор .
+//
+// Каждое присваивание полю volatile регистра - отдельные чтение, изменение и запись.
+// modify() читает регистр один раз, передаёт функции m копию в ram, и записывает результат один раз:
+//	(reg.*control).modify ( [&](TimerControl8& c) { c.clockType = prsc; c.waveform = TimerControl8::ClearOnCompare; } );
+// Копия не volatile, поэтому присваивания константам компилятор сводит к одному and и одному or.
 
 template< typename Bit >
 class Bitfield : public Bit
@@ -226,6 +261,14 @@ public:
 	{
 		return *((volatile Base*)this);
 	}
+
+	template <typename Modifier>
+	void modify (Modifier m) volatile
+	{
+		Bitfield local (*this);
+		m ( static_cast<Bit&>(local) );
+		*this = local;
+	}
 };
 
 
@@ -233,12 +276,26 @@ public:
 // Если размер Bit не соответсвует никакому базовому типу,
 // то предлагается использовать BitfieldDummy, который не выполняет никаких функций, но
 // предоставляет доступ к элементам Bit через . для единообразия
+// modify() работает побайтно: читает все байты, а записывает только изменившиеся
+// (зарезервированные адреса внутри Bit не трогаются)
 template< typename Bit >
 class BitfieldDummy : public Bit
 {
 public:
 	typedef Bit ParentBit;
 
+	template <typename Modifier>
+	void modify (Modifier m) volatile
+	{
+		Bit local;
+		for (uint8_t i = 0; i < sizeof(Bit); ++i)
+			((uint8_t*)&local)[i] = ((volatile uint8_t*)this)[i];
+		Bit old = local;
+		m (local);
+		for (uint8_t i = 0; i < sizeof(Bit); ++i)
+			if ( ((uint8_t*)&local)[i] != ((uint8_t*)&old)[i] )
+				((volatile uint8_t*)this)[i] = ((uint8_t*)&local)[i];
+	}
 };
 
 
@@ -460,7 +517,57 @@ struct Register
 	volatile uint8_t reservedFF; // 0xFF
 };
 
-#define reg (*(Register*) (0x20))
+// Адрес начала регистров. Переопределяется для сборки тестов на компьютере (регистры в памяти модели)
+#ifndef REGISTER_BASE
+#define REGISTER_BASE 0x20
+#endif
+#define reg (*(Register*) (REGISTER_BASE))
+
+
+// Группа пинов одного порта
+// Маска собирается при компиляции. Каждая операция - одно чтение-изменение-запись регистра
+// под запретом прерываний: все пины группы меняются одновременно, без промежуточных состояний,
+// и изменения других пинов порта из прерываний не теряются.
+//	typedef PortPins<&Register::portB, 1, 2, 4> Control;
+//	Control::out ();
+//	Control::write (0b00010010);	// pin1 = 1, pin2 = 0, pin4 = 1
+template <uint8_t... pins> struct PinMask;
+	template <> struct PinMask<> { static constexpr uint8_t value = 0; };
+	template <uint8_t pin, uint8_t... rest> struct PinMask<pin, rest...>
+	{
+		static_assert (pin < 8, "Pin number must be less than 8");
+		static constexpr uint8_t value = (1 << pin) | PinMask<rest...>::value;
+	};
+
+template <Port Register::* port, uint8_t... pins>
+struct PortPins
+{
+	static constexpr uint8_t mask = PinMask<pins...>::value;
+
+	static void set ()						{ PROFILE_ATOMIC(CriticalProfile::port) (reg.*port).set (mask); }
+	static void clear ()					{ PROFILE_ATOMIC(CriticalProfile::port) (reg.*port).clear (mask); }
+	static void write (uint8_t value)		{ PROFILE_ATOMIC(CriticalProfile::port) (reg.*port).write (mask, value); }
+	static void toggle ()					{ (reg.*port).toggle (mask); }		// Запись в PIN - без чтения
+	static void in ()						{ PROFILE_ATOMIC(CriticalProfile::port) (reg.*port).in (mask); }
+	static void inPulled ()					{ PROFILE_ATOMIC(CriticalProfile::port) (reg.*port).inPulled (mask); }
+	static void out ()						{ PROFILE_ATOMIC(CriticalProfile::port) (reg.*port).out (mask); }
+	static uint8_t read ()					{ return (reg.*port) & mask; }
+};
+
+// Пины на нескольких портах: одна операция на каждую группу PortPins (т.е. на каждый порт), в порядке перечисления.
+// Порядок задаёт список инициализации массива (порядок вычисления аргументов функции не определён).
+// Первый 0 - чтобы массив не был пустым при пустой группе.
+//	PinGroup< PortPins<&Register::portB, 1, 2>, PortPins<&Register::portE, 4> >::out ();
+template <class... Groups>
+struct PinGroup
+{
+	static void set ()		{ int dummy[] = { 0, (Groups::set (), 0)... };		(void) dummy; }
+	static void clear ()	{ int dummy[] = { 0, (Groups::clear (), 0)... };	(void) dummy; }
+	static void toggle ()	{ int dummy[] = { 0, (Groups::toggle (), 0)... };	(void) dummy; }
+	static void in ()		{ int dummy[] = { 0, (Groups::in (), 0)... };		(void) dummy; }
+	static void inPulled ()	{ int dummy[] = { 0, (Groups::inPulled (), 0)... };	(void) dummy; }
+	static void out ()		{ int dummy[] = { 0, (Groups::out (), 0)... };		(void) dummy; }
+};
 
 
 
@@ -23,6 +23,9 @@
  *	2.1  Эта таблица статична, поэтому может быть помещена во flash-память,
  *	     что при её огромном размере оправдывает её использование.
  *	2.2  Максимальное значение ключа ограничено 255.
+ *	2.3  Для 16-битных ключей (идентификаторы CAN, номера параметров) таблица делается двухуровневой,
+ *	     как каталог страниц: по старшим битам ключа находится страница, по младшим - номер элемента.
+ *	     Все страницы без ключей используют одну общую страницу из нулей. Поиск - по-прежнему два чтения flash.
  *	3. Если пользователь запрашивает данное по ключу, который не был указан в списке при создании,
  *	   то предоставляется доступ к специальному данному, "корзине", хранящемуся в массиве под номером 0.
  *
@@ -48,13 +51,18 @@
  *  в котором все возможные ключи перечисленны в KeyList
  *  в виде типов Loki::Int2Type в списке типов Loki::TL::Typelist.
  *	Доступ к элементам по ключам осуществляет с помощью перегруженного оператора [].
+ *	MapStaticPaged<Type, KeyList, pageBits> - то же для ключей до 65535.
+ *	MapStaticSparse<Type, KeyList> - для немногих разбросанных ключей: отсортированные ключи и двоичный поиск.
+ *	MapStaticAuto<Type, KeyList, maxSearchSteps> - сам выбирает одну из трёх таблиц с наименьшим размером во flash.
+ *	Flash: (maxKey >> pageBits) + 1 байт каталога и по 2^pageBits байт на каждую страницу с ключами плюс одна пустая.
  *
  *  ~~~ Комментарии: ~~~
  *  1. Хотелось бы создавать таблицу не из 256 элементов, а из N,
  *     где N - максимальный ключь в списке используемых ключей.
- *     Но, похоже, невозможно инициализировать массив разным числом элементов.
- *     Нужен другой подход типа генерирования классов с одной статической переменной.
- *     Но тут вопрос с обращением по индексу, когда индекс не известен на момент компиляции.
+ *     Это сделано в ReIndexWindow: ключи переводятся в constexpr-массив (KeyArray),
+ *     а массив нужного размера инициализируется раскрытием IndexSequence { find(minKey + i)... }.
+ *     Таблица занимает maxKey - minKey + 1 байт, а компилятору не нужно 256 раз искать ключ в списке типов.
+ *     ReIndex16 и ReIndex256 больше не используются MapStatic и оставлены для совместимости.
  *  2. Для облегчения создания списков типов используемых клченй определены макросы INT_TYPELIST_N
  *
  *  ~~~ Пример использования: ~~~
@@ -117,9 +125,11 @@ class Val
 private:
 	typedef typename Even<TList>::Result Keys;
 	enum { findNum = IndexOf< Keys, n >::value };
+	// Отсутствующий ключ (findNum = -1) - индекс за концом списка, а не -1: параметр TypeAtNonStrict беззнаковый
+	enum { valueNum = findNum < 0 ? Length<TList>::value : findNum*2 + 1 };
 
 public:
-	typedef typename TypeAtNonStrict< TList, findNum*2 + 1, Int2Type<0> >::Result Result;
+	typedef typename TypeAtNonStrict< TList, valueNum, Int2Type<0> >::Result Result;
 };
 
 
@@ -245,6 +255,7 @@ template <class TList>
 class ReIndex16
 {
 public:
+	enum { flashSize = 16 };
 	uint8_t operator[] (const uint8_t& key) { return pgm_read_byte(&array[key]); }
 private:
 	static uint8_t array[16] __attribute__ ((section (".text")));
@@ -274,6 +285,7 @@ template <class TList>
 class ReIndex256
 {
 public:
+	enum { flashSize = 256 };
 	uint8_t operator[] (const uint8_t& key) { return pgm_read_byte(&array[key]); }
 private:
 	static uint8_t array[256] __attribute__ ((section (".text")));
@@ -539,33 +551,442 @@ uint8_t ReIndex256<TList>::array[256]=	{ Val< Int2Type<  0>,	TList >::Result::va
 									 };
 
 
+// ------------------------------------- IndexSequence --------------------------------------------
+// Последовательность чисел 0, 1, ... n-1 в параметрах шаблона.
+// Нужна, чтобы инициализировать массив произвольного размера одним выражением { f(i)... }
+// Генерируется удвоением, поэтому глубина рекурсии шаблонов - log2(n)
+// ------------------------------------------------------------------------------------------------
+template <uint16_t... i>
+struct IndexSequence
+{
+	typedef IndexSequence< i..., (sizeof...(i) + i)... > Double;
+	typedef IndexSequence< i..., (sizeof...(i) + i)..., 2*sizeof...(i) > DoublePlusOne;
+};
+
+template <uint16_t n, bool odd = n % 2> struct MakeIndexSequence;
+
+	template <uint16_t n>
+	struct MakeIndexSequence<n, false>
+	{
+		typedef typename MakeIndexSequence<n/2>::Result::Double Result;
+	};
+
+	template <uint16_t n>
+	struct MakeIndexSequence<n, true>
+	{
+		typedef typename MakeIndexSequence<n/2>::Result::DoublePlusOne Result;
+	};
+
+	template <>
+	struct MakeIndexSequence<0, false>
+	{
+		typedef IndexSequence<> Result;
+	};
+
+
+// --------------------------------------- KeyArray -----------------------------------------------
+// Ключи из списка Int2Type в виде массива, доступного constexpr-функциям.
+// Номер ключа - его позиция в списке начиная с 1, 0 - ключ отсутствует.
+// Все переборы делятся пополам, поэтому глубина рекурсии constexpr - log2 от числа ключей или страниц.
+// ------------------------------------------------------------------------------------------------
+template <uint16_t... keys>
+struct KeyArray
+{
+	static constexpr uint16_t count = sizeof...(keys);
+	static constexpr uint16_t key[sizeof...(keys) + 1] = { keys..., 0 };
+
+	static constexpr uint8_t find (uint16_t k, uint16_t lo = 0, uint16_t hi = count)
+	{
+		return 	hi - lo == 0 ? 0 :
+				hi - lo == 1 ? ( key[lo] == k ? lo + 1 : 0 ) :
+				either ( find (k, lo, (lo+hi)/2), find (k, (lo+hi)/2, hi) );
+	}
+	static constexpr uint16_t maxKey (uint16_t lo = 0, uint16_t hi = count)
+	{
+		return 	hi - lo == 0 ? 0 :
+				hi - lo == 1 ? key[lo] :
+				bigger ( maxKey (lo, (lo+hi)/2), maxKey ((lo+hi)/2, hi) );
+	}
+	static constexpr uint16_t minKey (uint16_t lo = 0, uint16_t hi = count)
+	{
+		return 	hi - lo == 0 ? 0 :
+				hi - lo == 1 ? key[lo] :
+				smaller ( minKey (lo, (lo+hi)/2), minKey ((lo+hi)/2, hi) );
+	}
+
+	// Для массива, отсортированного по возрастанию: первая позиция с key[] >= k (count, если таких нет)
+	static constexpr uint16_t lowerBound (uint16_t k, uint16_t lo = 0, uint16_t hi = count)
+	{
+		return 	hi - lo == 0 ? lo :
+				key[(lo+hi)/2] < k ? lowerBound (k, (lo+hi)/2 + 1, hi) : lowerBound (k, lo, (lo+hi)/2);
+	}
+	// Деление ключа на страницу и смещение для ReIndexPaged: каталог и страница примерно поровну бит maxKey
+	// (8/8 для 16-битных ключей)
+	static constexpr uint8_t pageBits () { return (bitLength (maxKey ()) + 1) / 2; }
+
+	// Число ключей меньше k
+	static constexpr uint16_t less (uint16_t k, uint16_t lo = 0, uint16_t hi = count)
+	{
+		return 	hi - lo == 0 ? 0 :
+				hi - lo == 1 ? key[lo] < k :
+				less (k, lo, (lo+hi)/2) + less (k, (lo+hi)/2, hi);
+	}
+	// Ключ, стоящий на месте rank в отсортированном по возрастанию списке
+	static constexpr uint16_t sorted (uint16_t rank, uint16_t lo = 0, uint16_t hi = count)
+	{
+		return 	hi - lo == 1 ? key[lo] :
+				rankIn (rank, lo, (lo+hi)/2) ? sorted (rank, lo, (lo+hi)/2) : sorted (rank, (lo+hi)/2, hi);
+	}
+
+private:
+	static constexpr bool rankIn (uint16_t rank, uint16_t lo, uint16_t hi)
+	{
+		return 	hi - lo == 0 ? false :
+				hi - lo == 1 ? less (key[lo]) == rank :
+				rankIn (rank, lo, (lo+hi)/2) || rankIn (rank, (lo+hi)/2, hi);
+	}
+	static constexpr uint8_t either (uint8_t a, uint8_t b) { return a ? a : b; }
+	static constexpr uint16_t bigger (uint16_t a, uint16_t b) { return a > b ? a : b; }
+	static constexpr uint16_t smaller (uint16_t a, uint16_t b) { return a < b ? a : b; }
+	static constexpr uint8_t bitLength (uint16_t k) { return k ? 1 + bitLength (k >> 1) : 0; }
+};
+
+template <uint16_t... keys>
+constexpr uint16_t KeyArray<keys...>::key[sizeof...(keys) + 1];
+
+template <uint16_t k, class Keys> struct PrependKey;
+
+	template <uint16_t k, uint16_t... keys>
+	struct PrependKey< k, KeyArray<keys...> >
+	{
+		typedef KeyArray<k, keys...> Result;
+	};
+
+template <class TList> struct MakeKeyArray;
+
+	template <uint16_t k, class Tail>
+	struct MakeKeyArray< Typelist<Int2Type<k>, Tail> >
+	{
+		typedef typename PrependKey< k, typename MakeKeyArray<Tail>::Result >::Result Result;
+	};
+
+	template <>
+	struct MakeKeyArray< NullType >
+	{
+		typedef KeyArray<> Result;
+	};
+
+
+// --------------------------------------- ReIndexWindow ------------------------------------------
+// Таблица только на окно ключей [minKey, maxKey]: в ячейке key - minKey хранится номер элемента.
+// Размер во flash - maxKey - minKey + 1 байт. Ключи вне окна дают 0 (корзина).
+// Строится constexpr-функциями KeyArray без перебора всех 256 значений через списки типов.
+// ------------------------------------------------------------------------------------------------
+template <class Keys, class Index> class ReIndexWindowTable;
+
+template <uint16_t... keys, uint16_t... i>
+class ReIndexWindowTable< KeyArray<keys...>, IndexSequence<i...> >
+{
+protected:
+	typedef KeyArray<keys...> Keys;
+	enum { minKey = Keys::minKey(), size = sizeof...(i) };
+
+	static uint8_t array[sizeof...(i)] __attribute__ ((section (".text")));
+};
+
+template <uint16_t... keys, uint16_t... i>
+uint8_t ReIndexWindowTable< KeyArray<keys...>, IndexSequence<i...> >
+	::array[sizeof...(i)] = { KeyArray<keys...>::find (minKey + i)... };
+
+template <class TList>
+class ReIndexWindow
+	: private ReIndexWindowTable <
+				typename MakeKeyArray<TList>::Result,
+				typename MakeIndexSequence< MakeKeyArray<TList>::Result::maxKey() - MakeKeyArray<TList>::Result::minKey() + 1 >::Result
+								 >
+{
+	static_assert (Length<TList>::value < 256, "Element number is uint8_t");
+
+public:
+	enum { flashSize = ReIndexWindow::size };	// Байт во flash
+
+	uint8_t operator[] (const uint16_t& key)
+	{
+		uint16_t n = key - this->minKey;	// Ключи меньше minKey переходят через 0 и тоже отсекаются
+		if ( n >= this->size )
+			return 0;
+		return pgm_read_byte (&this->array[n]);
+	}
+};
+
+
+// --------------------------------------- ReIndexSparse ------------------------------------------
+// Для немногих разбросанных ключей: во flash хранятся отсортированные ключи и номера элементов,
+// 3 байта на ключ независимо от разброса.
+// Поиск - двоичный без ветвлений по результату сравнения: число шагов ceil(log2(n)) известно
+// при компиляции, на каждом шаге одно чтение pgm_read_word и условное сложение.
+// ------------------------------------------------------------------------------------------------
+template <class Keys, class Index> class ReIndexSparseTable;
+
+template <uint16_t... keys, uint16_t... i>
+class ReIndexSparseTable< KeyArray<keys...>, IndexSequence<i...> >
+{
+protected:
+	enum { size = sizeof...(i) };
+
+	static uint16_t key[sizeof...(i)] __attribute__ ((section (".text")));
+	static uint8_t number[sizeof...(i)] __attribute__ ((section (".text")));
+};
+
+template <uint16_t... keys, uint16_t... i>
+uint16_t ReIndexSparseTable< KeyArray<keys...>, IndexSequence<i...> >
+	::key[sizeof...(i)] = { KeyArray<keys...>::sorted (i)... };
+
+template <uint16_t... keys, uint16_t... i>
+uint8_t ReIndexSparseTable< KeyArray<keys...>, IndexSequence<i...> >
+	::number[sizeof...(i)] = { KeyArray<keys...>::find ( KeyArray<keys...>::sorted (i) )... };
+
+template <class TList>
+class ReIndexSparse
+	: private ReIndexSparseTable <
+				typename MakeKeyArray<TList>::Result,
+				typename MakeIndexSequence< Length<TList>::value >::Result
+								 >
+{
+	static_assert (Length<TList>::value > 0 && Length<TList>::value < 256, "Element number is uint8_t");
+
+public:
+	enum { flashSize = ReIndexSparse::size * 3 };	// Байт во flash
+
+	uint8_t operator[] (const uint16_t& key)
+	{
+		uint8_t base = 0;
+		for (uint8_t n = this->size; n > 1; )
+		{
+			uint8_t half = n / 2;
+			if ( pgm_read_word (&this->key[base + half]) <= key )
+				base += half;
+			n -= half;
+		}
+		return pgm_read_word (&this->key[base]) == key ? pgm_read_byte (&this->number[base]) : 0;
+	}
+};
+
+
+// --------------------------------------- ReIndexPaged -------------------------------------------
+// Двухуровневая таблица для 16-битных ключей (аналог каталога страниц).
+// Ключ делится на номер страницы (key >> bits) и смещение в странице (младшие bits бит).
+// directory[номер страницы] - номер ячейки в pages, pages - ячейки по 2^bits номеров элементов.
+// Ячейка 0 - общая для всех страниц без ключей и заполнена нулями.
+// Поиск - два pgm_read_byte. Размер во flash: (maxKey >> bits) + 1 + (занятых страниц + 1) << bits байт.
+// ------------------------------------------------------------------------------------------------
+// Ключи сортируются (Sorted), и одним проходом по ним (PageGroups) каждому ключу сопоставляется номер
+// его занятой страницы среди всех занятых по возрастанию - накопленное число смен страницы.
+// Тогда ячейка каталога и ячейка страницы находятся двоичным поиском по Sorted и Groups,
+// и время компиляции растёт как (размер таблиц) * log2(число ключей), а не как квадрат числа страниц.
+// ------------------------------------------------------------------------------------------------
+template <class Keys, class Index> struct SortKeys;
+
+	template <uint16_t... keys, uint16_t... i>
+	struct SortKeys< KeyArray<keys...>, IndexSequence<i...> >
+	{
+		typedef KeyArray< KeyArray<keys...>::sorted (i)... > Result;
+		typedef KeyArray< KeyArray<keys...>::find ( KeyArray<keys...>::sorted (i) )... > Numbers;	// Номера элементов
+	};
+
+template <class Sorted, uint8_t bits, uint16_t rank, uint16_t group, bool end, uint16_t... groups> struct PageGroups;
+
+	template <class Sorted, uint8_t bits, uint16_t rank, uint16_t group, uint16_t... groups>
+	struct PageGroups< Sorted, bits, rank, group, false, groups... >
+	{
+		enum { next = group + ( rank + 1 < Sorted::count && (Sorted::key[rank + 1] >> bits) != (Sorted::key[rank] >> bits) ) };
+		typedef typename PageGroups< Sorted, bits, rank + 1, next, rank + 1 == Sorted::count, groups..., group >::Result Result;
+	};
+
+	template <class Sorted, uint8_t bits, uint16_t rank, uint16_t group, uint16_t... groups>
+	struct PageGroups< Sorted, bits, rank, group, true, groups... >
+	{
+		typedef KeyArray<groups...> Result;
+	};
+
+template <class TList, uint8_t bits>
+struct PagedKeys
+{
+	typedef typename MakeKeyArray<TList>::Result Keys;
+	typedef SortKeys< Keys, typename MakeIndexSequence<Keys::count>::Result > Sort;
+	typedef typename Sort::Result Sorted;
+	typedef typename Sort::Numbers Numbers;
+	typedef typename PageGroups< Sorted, bits, 0, 0, Keys::count == 0 >::Result Groups;
+
+	static constexpr uint16_t directorySize = (Keys::maxKey() >> bits) + 1;
+	static constexpr uint16_t usedPages = Keys::count ? Groups::key[Keys::count - 1] + 1 : 0;
+	static constexpr uint32_t pagesSize = uint32_t(usedPages + 1) << bits;
+
+	// Ячейка страницы page в pages, 0 - на странице нет ключей
+	static constexpr uint8_t slot (uint16_t page)
+	{
+		return slotAt (page, Sorted::lowerBound (page << bits));
+	}
+	// Номер элемента в ячейке n массива pages
+	static constexpr uint8_t entry (uint16_t n)
+	{
+		return (n >> bits) == 0 ? 0 :
+				number ( ((Sorted::key[ Groups::lowerBound ((n >> bits) - 1) ] >> bits) << bits) | (n & ((1 << bits) - 1)) );
+	}
+
+private:
+	static constexpr uint8_t slotAt (uint16_t page, uint16_t rank)
+	{
+		return rank < Keys::count && (Sorted::key[rank] >> bits) == page ? Groups::key[rank] + 1 : 0;
+	}
+	static constexpr uint8_t number (uint16_t k)
+	{
+		return numberAt (k, Sorted::lowerBound (k));
+	}
+	static constexpr uint8_t numberAt (uint16_t k, uint16_t rank)
+	{
+		return rank < Keys::count && Sorted::key[rank] == k ? Numbers::key[rank] : 0;
+	}
+};
+
+template <class Paged, class DirectoryIndex, class PagesIndex> class ReIndexPagedTable;
+
+template <class Paged, uint16_t... d, uint16_t... t>
+class ReIndexPagedTable< Paged, IndexSequence<d...>, IndexSequence<t...> >
+{
+protected:
+	enum { directorySize = sizeof...(d) };
+
+	static uint8_t directory[sizeof...(d)] __attribute__ ((section (".text")));
+	static uint8_t pages[sizeof...(t)] __attribute__ ((section (".text")));
+};
+
+template <class Paged, uint16_t... d, uint16_t... t>
+uint8_t ReIndexPagedTable< Paged, IndexSequence<d...>, IndexSequence<t...> >
+	::directory[sizeof...(d)] = { Paged::slot (d)... };
+
+template <class Paged, uint16_t... d, uint16_t... t>
+uint8_t ReIndexPagedTable< Paged, IndexSequence<d...>, IndexSequence<t...> >
+	::pages[sizeof...(t)] = { Paged::entry (t)... };
+
+template <class TList, uint8_t bits = MakeKeyArray<TList>::Result::pageBits()>
+class ReIndexPaged
+	: private ReIndexPagedTable <
+				PagedKeys<TList, bits>,
+				typename MakeIndexSequence< PagedKeys<TList, bits>::directorySize >::Result,
+				typename MakeIndexSequence< PagedKeys<TList, bits>::pagesSize >::Result
+								>
+{
+	static_assert (Length<TList>::value < 256, "Element number is uint8_t");
+	static_assert (PagedKeys<TList, bits>::pagesSize <= 0xFFFF, "Pages do not fit 16-bit index: decrease pageBits");
+
+public:
+	enum { flashSize = PagedKeys<TList, bits>::directorySize + PagedKeys<TList, bits>::pagesSize };	// Байт во flash
+
+	uint8_t operator[] (const uint16_t& key)
+	{
+		uint16_t page = key >> bits;
+		if ( page >= this->directorySize )
+			return 0;
+		uint16_t slot = pgm_read_byte (&this->directory[page]);
+		return pgm_read_byte (&this->pages[ (slot << bits) | (key & ((1 << bits) - 1)) ]);
+	}
+};
+
+
 // ----------------------------------------- MapStatic --------------------------------------------
 // Представляет собой ассоциативный массив,
 //	в котором все возможные ключи заданы на момент компиляции списком KeyList. (элементы Int2Type)
 // Type - тип хранимых значений
 // Реализуется хеш-функцией, которая представляет собой таблицу во flash-памяти.
-//	В зависимости от максимального значения ключа выбирается версия 16 или 256.
-//	Соответсвенно в flash-памяти они будут занимать 16 или 256 байт.
 // ------------------------------------------------------------------------------------------------
+//	Таблица занимает только окно от минимального до максимального ключа (ReIndexWindow).
+//	MapStatic16 и MapStatic256 оставлены для совместимости и работают так же.
+// ------------------------------------------------------------------------------------------------
+template <class Type, class KeyList>
+class MapStatic
+{
+public:
+	Type& operator[] (uint16_t key) { return data[ hash[key] ]; }
+
+private:
+	ReIndexWindow< KeyList > hash;
+	Type data[ Length<KeyList>::value + 1 ];
+};
+
+// Ключи до 65535. Поиск двоичный по отсортированным ключам (ReIndexSparse), 3 байта flash на ключ.
 template <class Type, class KeyList>
-class MapStatic16
+class MapStaticSparse
 {
 public:
-	Type& operator[] (uint8_t key) { return data[ hash[key] ]; }
+	Type& operator[] (uint16_t key) { return data[ hash[key] ]; }
 
 private:
-	ReIndex16< typename Numbered<KeyList>::Result > hash;
+	ReIndexSparse< KeyList > hash;
 	Type data[ Length<KeyList>::value + 1 ];
 };
 
 template <class Type, class KeyList>
-class MapStatic256
+class MapStatic16 : public MapStatic<Type, KeyList>
+{
+	static_assert (MakeKeyArray<KeyList>::Result::maxKey() < 16, "MapStatic16 keys are 0...15");
+};
+
+template <class Type, class KeyList>
+class MapStatic256 : public MapStatic<Type, KeyList>
+{
+	static_assert (MakeKeyArray<KeyList>::Result::maxKey() < 256, "MapStatic256 keys are 0...255");
+};
+
+// Ключи до 65535. Элемент по ключу находится по двухуровневой таблице ReIndexPaged.
+// pageBits - размер страницы (2^pageBits ключей): чем больше, тем меньше каталог, но больше каждая занятая страница.
+// По умолчанию биты maxKey делятся между каталогом и страницей поровну (8/8 для 16-битных ключей).
+template <class Type, class KeyList, uint8_t pageBits = MakeKeyArray<KeyList>::Result::pageBits()>
+class MapStaticPaged
+{
+public:
+	Type& operator[] (uint16_t key) { return data[ hash[key] ]; }
+
+private:
+	ReIndexPaged< KeyList, pageBits > hash;
+	Type data[ Length<KeyList>::value + 1 ];
+};
+
+// ------------------------------------------ MapStaticAuto ---------------------------------------
+// Выбирает при компиляции таблицу с наименьшим размером во flash:
+//	ReIndexWindow	- maxKey - minKey + 1 байт, одно чтение flash
+//	ReIndexPaged	- каталог и страницы с делением ключа по умолчанию (KeyArray::pageBits), два чтения flash
+//	ReIndexSparse	- 3 байта на ключ, ceil(log2(n)) + 2 чтения flash
+// ReIndexSparse рассматривается, только если число шагов поиска не больше maxSearchSteps
+// (ограничение на время поиска). При равном размере выбирается более быстрая таблица.
+// ------------------------------------------------------------------------------------------------
+template <class KeyList, uint8_t maxSearchSteps>
+class ReIndexAuto
+{
+	typedef typename MakeKeyArray<KeyList>::Result Keys;
+	enum { pageBits = Keys::pageBits() };
+
+	static constexpr uint8_t steps (uint16_t n) { return n > 1 ? 1 + steps ((n + 1) / 2) : 0; }
+
+	static constexpr uint32_t windowSize = Keys::maxKey() - Keys::minKey() + 1;
+	static constexpr uint32_t pagedSize = PagedKeys<KeyList, pageBits>::directorySize + PagedKeys<KeyList, pageBits>::pagesSize;
+	static constexpr uint32_t sparseSize = steps (Keys::count) <= maxSearchSteps ? Keys::count * 3 : 0xFFFFFFFF;
+
+	typedef typename Select< (pagedSize < windowSize), ReIndexPaged<KeyList, pageBits>, ReIndexWindow<KeyList> >::Result Direct;
+	static constexpr uint32_t directSize = pagedSize < windowSize ? pagedSize : windowSize;
+
+public:
+	typedef typename Select< (sparseSize < directSize), ReIndexSparse<KeyList>, Direct >::Result Result;
+};
+
+template <class Type, class KeyList, uint8_t maxSearchSteps = 8>
+class MapStaticAuto
 {
 public:
-	Type& operator[] (uint8_t key) { return data[ hash[key] ]; }
+	Type& operator[] (uint16_t key) { return data[ hash[key] ]; }
 
 private:
-	ReIndex256< typename Numbered<KeyList>::Result > hash;
+	typename ReIndexAuto< KeyList, maxSearchSteps >::Result hash;
 	Type data[ Length<KeyList>::value + 1 ];
 };
 
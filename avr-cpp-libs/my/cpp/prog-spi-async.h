@@ -0,0 +1,289 @@
+/*
+ * prog-spi-async.h
+ *
+ * Программирование соседней микросхемы по SPI в фоне
+ * **************************************************
+ *
+ *  ~~~ Проблема: ~~~
+ *  ProgSpiSimple ждёт окончания передачи каждого байта в цикле, а после записи страницы - T_WD_FLASH.
+ *  Пока перепрограммируется сосед (десятки секунд), основной цикл стоит: CAN и Dispatcher не обслуживаются.
+ *
+ *  ~~~ Решение: ~~~
+ *  1. Страница передаётся из прерывания SPI_STC: каждое прерывание кладёт в передатчик следующий байт инструкции.
+ *     Основной цикл в это время свободен.
+ *  2. После инструкции записи страницы прерывание ставит в Dispatcher комманду, которая (уже из основного цикла)
+ *     ставит в Scheduler ожидание T_WD_FLASH/T_WD_EEPROM. С PROGSPI_POLL_READY ожидание идёт шагами по одному
+ *     дискрету часов с опросом Poll RDY/BSY, но не дольше T_WD_...
+ *  3. По окончании операции выполняется комманда done. Из неё можно запускать следующую страницу -
+ *     так без блокировок пишется весь образ, а done служит сообщением о ходе записи.
+ *
+ *  ~~~ Интерфейс: ~~~
+ *  ProgSpiAsync< control, dataReg, Scheduler, scheduler > async;
+ *  async.setGeometry (simple);		// Размеры страниц из ProgSpiSimple, после его rebootInProg()
+ *  async.writePage<type> (address, data, length, done);	// false - предыдущая операция не закончена или блок не подходит
+ *  async.readBlock<type> (address, data, length, done);
+ *  async.isBusy ();
+ *
+ *  ~~~ Ограничения: ~~~
+ *  1. Вход в режим программирования, отчистка и fuse - через ProgSpiSimple (блокирующие, но короткие или однократные).
+ *     Пока isBusy(), ProgSpiSimple использовать нельзя: у них общий передатчик.
+ *  2. Буфер data должен жить до выполнения done, он не копируется.
+ *  3. writePage пишет одну страницу: [address, address+length) должен лежать в одной странице микросхемы,
+ *     иначе writePage возвращает false. Страницы - из setGeometry (без него FLASH_PAGE_SIZE и EEPROM_PAGE_SIZE).
+ *  4. Занимает прерывание SPI_STC.
+ *  5. Flash только до 128 кБ: Load Extended Address не посылается, поэтому writePage и readBlock
+ *     за этой границей (ATmega2560/2561) возвращают false - такие адреса только через ProgSpiSimple.
+ *
+ *  ~~~ Пример использования: ~~~
+	using namespace ProgSpi;
+
+	ProgSpiSimple<&Register::spiStatusControl, &Register::spiData, &Register::portB, 0, 1, 2, 3, &Register::portE, 4> neighbour;
+	ProgSpiAsync<&Register::spiStatusControl, &Register::spiData, decltype(scheduler), scheduler> neighbourAsync;
+
+	uint8_t page[FLASH_PAGE_SIZE];		// Наибольшая страница, у соседа может быть меньше
+	uint16_t pageNumber;
+
+	void nextPage (uint16_t)
+	{
+		if ( pageNumber == pages )
+		{
+			neighbour.rebootInWork ();
+			return;
+		}
+		uint16_t pageSize = neighbour.getFlashPageSize ();
+		getImagePage (pageNumber, page, pageSize);	// Например, из принятого по CAN
+		neighbourAsync.writePage<flash> ( uint32_t(pageNumber++) * pageSize, page, pageSize,
+										  Command{SoftIntHandler::from_function<&nextPage>(), 0} );
+	}
+
+	void startUpdate ()
+	{
+		if ( neighbour.rebootInProg () )
+		{
+			neighbour.erase ();
+			neighbourAsync.setGeometry (neighbour);
+			pageNumber = 0;
+			nextPage (0);
+		}
+	}
+ *
+ */
+
+#ifndef PROG_SPI_ASYNC_H_
+#define PROG_SPI_ASYNC_H_
+
+#include <cpp/prog-spi.h>
+#include <cpp/interrupt-dynamic.h>
+#include <cpp/dispatcher.h>
+
+namespace ProgSpi
+{
+
+template <	volatile Bitfield<SpiStatusControl> Register::* control, volatile uint8_t Register::* dataReg,
+			class Scheduler, Scheduler& scheduler	>
+class ProgSpiAsync
+{
+public:
+	ProgSpiAsync ()
+		: busy (false), flashPageSize (FLASH_PAGE_SIZE), eepromPageSize (EEPROM_PAGE_SIZE)
+	{
+		SPI_STC_handler = InterruptHandler::from_method <ProgSpiAsync, &ProgSpiAsync::interruptHandler>(this);
+	}
+
+	// Геометрия памяти соседа, которую ProgSpiSimple определил по сигнатуре
+	template <class Simple>
+	void setGeometry (const Simple& simple)
+	{
+		flashPageSize = simple.getFlashPageSize ();
+		eepromPageSize = simple.getEepromPageSize ();
+	}
+
+	template <MemType type>
+	bool writePage (uint32_t address, const uint8_t* data, uint16_t length, const Command& done)
+	{
+		static_assert (type == flash || type == eeprom, "Unknown memory type");
+		uint16_t pageSize = type == flash ? flashPageSize : eepromPageSize;
+		if ( (address & (pageSize - 1)) + uint32_t(length) > pageSize )		// Блок выходит за страницу
+			return false;
+		return start (type == flash ? loadFlash : loadEeprom, address, (uint8_t*)data, length, done);
+	}
+
+	template <MemType type>
+	bool readBlock (uint32_t address, uint8_t* data, uint16_t length, const Command& done)
+	{
+		static_assert (type == flash || type == eeprom, "Unknown memory type");
+		return start (type == flash ? readFlash : readEeprom, address, data, length, done);
+	}
+
+	bool isBusy () const { return busy; }
+
+private:
+	enum Operation : uint8_t
+	{
+		loadFlash,
+		loadEeprom,
+		readFlash,
+		readEeprom
+	};
+
+	volatile bool busy;
+	uint16_t flashPageSize;
+	uint8_t eepromPageSize;
+	uint16_t waitTime;				// Шаг ожидания, который не поместился в планировщик
+	Operation operation;
+	uint32_t address;
+	uint8_t* buffer;				// При записи только читается
+	uint16_t length;
+	uint16_t index;					// Номер текущей инструкции
+	uint8_t byteNumber;				// Номер байта в ней
+	uint8_t instr[4];
+	Command done;
+
+	static constexpr uint16_t ticks (double ms) { return uint16_t(ms * 1000 / Scheduler::discreetMks) + 1; }
+
+	bool start (Operation operation_, uint32_t address_, uint8_t* buffer_, uint16_t length_, const Command& done_)
+	{
+		if ( busy || length_ == 0 )
+			return false;
+		if ( (operation_ == loadFlash || operation_ == readFlash) && address_ + length_ > 0x20000 )	// Нужен Load Extended Address
+			return false;
+		busy = true;
+		operation = operation_;
+		address = address_;
+		buffer = buffer_;
+		length = length_;
+		done = done_;
+
+		index = 0;
+		byteNumber = 0;
+		prepare ();
+		(reg.*control).interruptEnable = true;
+		(reg.*dataReg) = instr[0];
+		return true;
+	}
+
+	// Формирует в instr инструкцию номер index. false - инструкции кончились
+	bool prepare ()
+	{
+		if ( index < length )
+		{
+			uint32_t a = address + index;
+			switch (operation)
+			{
+			case loadFlash:
+				instr[0] = 0x40 | ((a & 0b1) << 3);	instr[1] = 0;					instr[2] = a >> 1;	instr[3] = buffer[index];
+				break;
+			case loadEeprom:
+				instr[0] = 0xC1;					instr[1] = 0;					instr[2] = a & (eepromPageSize - 1);	instr[3] = buffer[index];
+				break;
+			case readFlash:
+				instr[0] = 0x20 | ((a & 0b1) << 3);	instr[1] = a >> 9;				instr[2] = a >> 1;	instr[3] = 0;
+				break;
+			case readEeprom:
+				instr[0] = 0xA0;					instr[1] = a >> 8;				instr[2] = a;		instr[3] = 0;
+				break;
+			}
+			return true;
+		}
+		if ( index == length )				// После загрузки страницы - её запись
+		{
+			if ( operation == loadFlash )
+			{
+				instr[0] = 0x4C;	instr[1] = address >> 9;	instr[2] = address >> 1;	instr[3] = 0;
+				return true;
+			}
+			if ( operation == loadEeprom )
+			{
+				instr[0] = 0xC2;	instr[1] = address >> 8;	instr[2] = address & ~(eepromPageSize - 1);	instr[3] = 0;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void interruptHandler ()
+	{
+		uint8_t answer = (reg.*dataReg);
+		if ( ++byteNumber < 4 )
+		{
+			(reg.*dataReg) = instr[byteNumber];
+			return;
+		}
+
+		if ( operation == readFlash || operation == readEeprom )
+			buffer[index] = answer;
+		index ++;
+		byteNumber = 0;
+		if ( prepare () )
+		{
+			(reg.*dataReg) = instr[0];
+			return;
+		}
+
+		(reg.*control).interruptEnable = false;
+		if ( operation == loadFlash || operation == loadEeprom )
+			dispatcher.add ( Command{SoftIntHandler::from_method<ProgSpiAsync, &ProgSpiAsync::committed>(this), 0} );
+		else
+		{
+			busy = false;
+			dispatcher.add (done);
+		}
+	}
+
+	// Из основного цикла: страница отправлена на запись, ждём её окончания
+	void committed (uint16_t)
+	{
+		uint16_t timeout = operation == loadFlash ? ticks (T_WD_FLASH) : ticks (T_WD_EEPROM);
+#ifdef PROGSPI_POLL_READY
+		wait (1, timeout);
+#else
+		wait (timeout, 0);
+#endif
+	}
+
+	void wait (uint16_t time, uint16_t left)
+	{
+		if ( !scheduler.runIn (Command{SoftIntHandler::from_method<ProgSpiAsync, &ProgSpiAsync::waited>(this), left}, time) )
+		{
+			// Нет места в планировщике - тот же шаг попробуем позже, не начиная ожидание заново
+			waitTime = time;
+			dispatcher.add ( Command{SoftIntHandler::from_method<ProgSpiAsync, &ProgSpiAsync::retryWait>(this), left} );
+		}
+	}
+
+	void retryWait (uint16_t left)
+	{
+		wait (waitTime, left);
+	}
+
+	void waited (uint16_t left)
+	{
+		(void) left;
+#ifdef PROGSPI_POLL_READY
+		if ( left != 0 && (poll () & 1) )			// Младший бит ответа: 1 - запись ещё идёт
+		{
+			wait (1, left - 1);
+			return;
+		}
+#endif
+		busy = false;
+		if ( done.handler )
+			done.handler (done.parameter);
+	}
+
+	uint8_t poll ()
+	{
+		uint8_t answer;
+		for (uint8_t i = 0; i < 4; ++i)
+		{
+			(reg.*dataReg) = i == 0 ? 0xF0 : 0;
+			while(! (reg.*control).transferComplete );
+			answer = (reg.*dataReg);
+		}
+		return answer;
+	}
+};
+
+} // namespace ProgSpi
+
+#endif /* PROG_SPI_ASYNC_H_ */
@@ -21,8 +21,46 @@
  *	- Запись данных с помощью << ещё не гарантирует, что данные уже запсаны. Это гарантирует вызвов функции flush()
  *	  Функция flush() автоматически вызвается при изменениии типа программируемой памяти, при манипуляциях с курсором и при вызове деструктора
  *	- Работами с битами fuse осуществляется с помощью фунций, начинающихся на fuse...
+ *	- Для больших объёмов есть блочные функции writePage(address, data, length) и readBlock(address, data, length).
+ *	  Они работают прямо с буфером вызывающего, не проверяют границу страницы на каждом байте и не используют position.
+ *	  writePage загружает и записывает блок [address, address+length) по страницам: блок делится по границам
+ *	  страниц микросхемы (getFlashPageSize(), getEepromPageSize()), поэтому может быть любой длины и начинаться где угодно.
+ *	- Обновление прошивки соседа обычно меняет несколько страниц. comparePage(address, data, length) сравнивает
+ *	  страницу в микросхеме с новыми данными и возвращает PageDiff:
+ *	    equal - совпадает, programmable - отличается, но её можно записать без отчистки (биты меняются только 1 -> 0),
+ *	    needErase - нужна отчистка. По SPI отчищается только вся микросхема (erase), после чего писать нужно всё.
+ *	  updatePage(address, data, length) записывает страницу, только если она отличается. Для eeprom в буфер страницы
+ *	  загружаются только изменившиеся байты (eeprom стирает байт сама, поэтому needErase для неё не бывает).
+ *	  Возвращает false, если flash странице нужна отчистка - тогда она не записывается.
+ *	  Пропущенные (совпавшие) страницы считаются в pagesSkipped.
  *	- Деструктор обеспечивает завершение всех операций чтения/записи и перезагружает микросхему в режим нормальной работы
  *
+ *	Частота SPI:
+ *	- rebootInProg(targetFrequency) начинает с самого быстрого делителя (F2), при котором SCK не больше targetFrequency/4.
+ *	  Если частота соседа неизвестна (0), то начинает с F4, как без подбора: быстрее можно, только когда частота известна.
+ *	  Переход в режим программирования проверяется эхом инструкции
+ *	  Programming Enable и первым байтом сигнатуры (0x1E). Если проверка не прошла, то делитель увеличивается вдвое,
+ *	  вплоть до F128.
+ *	- Найденный делитель запоминается: следующий rebootInProg() начинает с него, но не быстрее, чем позволяет targetFrequency.
+ *	- getPrescale() - выбранный делитель, getByteRate() - скорость чтения/записи в байтах в секунду
+ *	  (одна инструкция из 4 байт на байт данных, без учёта ожидания записи страниц).
+ *
+ *	Геометрия памяти:
+ *	- После перехода в режим программирования rebootInProg() читает сигнатуру и ищет её в таблице devices.
+ *	  Из таблицы берутся размеры страниц flash и eeprom, объёмы памяти и необходимость инструкции Load Extended Address (0x4D)
+ *	  для flash больше 128 кБ. Все функции записи и чтения используют эти значения.
+ *	- Если сигнатура не найдена (isKnownDevice() == false), то используются FLASH_PAGE_SIZE и EEPROM_PAGE_SIZE.
+ *	- Новая микросхема добавляется строкой в devices. Размеры страниц должны быть степенями двойки.
+ *
+ *	Ожидание окончания записи:
+ *	- По умолчанию после записи страницы, fuse и отчистки выдерживается максимальное время из datasheet (T_WD_...).
+ *	  Обычно запись заканчивается в несколько раз быстрее.
+ *	- Если определён PROGSPI_POLL_READY, то каждые 100 мкс посылается инструкция Poll RDY/BSY (0xF0),
+ *	  и ожидание заканчивается, как только микросхема сообщит о готовности. Если за время T_WD_... готовность
+ *	  так и не наступила, то ожидание всё равно заканчивается, как и без опроса.
+ *	- PROGSPI_POLL_READY не определять для микросхем, не поддерживающих Poll RDY/BSY (AT90S и более старые):
+ *	  их ответ не определён и может быть принят за готовность до окончания записи.
+ *
  */
 // -- Пример использования --
 //
@@ -78,7 +116,7 @@
 #define T_WD_EEPROM	9.0		// запись страницы EEPROM
 #define T_WD_ERASE	9.0		// отчистка Flash и EEPROM
 #define T_ST_PROG	20.0	// от включения до инструкции программирования
-// Размыры страниц памяти
+// Размыры страниц памяти, если микросхемы нет в таблице devices
 #define FLASH_PAGE_SIZE	 256
 #define EEPROM_PAGE_SIZE 8
 // ---------------------------------
@@ -88,6 +126,7 @@
 #include <cpp/io.h>
 //#define F_CPU 12000000UL 	// 12 MHz
 #include <util/delay.h>
+#include <avr/pgmspace.h>
 
 
 namespace ProgSpi
@@ -98,6 +137,40 @@ enum MemType : uint8_t
 	eeprom
 };
 
+enum PageDiff : uint8_t
+{
+	equal,
+	programmable,
+	needErase
+};
+
+struct Device
+{
+	uint16_t signature;				// Байты 1 и 2 сигнатуры (байт 0 - производитель, у Atmel 0x1E)
+	uint16_t flashSizeKb;
+	uint16_t flashPageSize;
+	uint16_t eepromSize;
+	uint8_t eepromPageSize;
+};
+
+Device devices[] __attribute__ ((section (".text"))) =
+{
+//	 сигнатура	flash кБ	страница	eeprom	страница
+	{0x9205,	4,			64,			256,	4},		// ATmega48
+	{0x930A,	8,			64,			512,	4},		// ATmega88
+	{0x9406,	16,			128,		512,	4},		// ATmega168
+	{0x950F,	32,			128,		1024,	4},		// ATmega328P
+	{0x960A,	64,			256,		2048,	8},		// ATmega644P
+	{0x9705,	128,		256,		4096,	8},		// ATmega1284P
+	{0x9703,	128,		256,		4096,	8},		// ATmega1280
+	{0x9704,	128,		256,		4096,	8},		// ATmega1281
+	{0x9801,	256,		256,		4096,	8},		// ATmega2560
+	{0x9802,	256,		256,		4096,	8},		// ATmega2561
+	{0x9581,	32,			256,		1024,	8},		// AT90CAN32
+	{0x9681,	64,			256,		2048,	8},		// AT90CAN64
+	{0x9781,	128,		256,		4096,	8}		// AT90CAN128
+};
+
 template <	volatile Bitfield<SpiStatusControl> Register::* control, volatile uint8_t Register::* dataReg,
 			Port Register::* port, uint8_t ssPin, uint8_t sckPin, uint8_t mosiPin, uint8_t misoPin,
 			Port Register::* resetPort, uint8_t resetPin	>
@@ -106,7 +179,7 @@ class ProgSpiSimple
 public:
 	ProgSpiSimple ();
 
-	bool rebootInProg ();			// Перевод программируемой микросхемы  в режим программирования
+	bool rebootInProg (uint32_t targetFrequency = 0);	// Перевод программируемой микросхемы в режим программирования
 	void rebootInWork ();			// Перевод программируемой микросхемы  в режим нормальной работы
 	bool isInProgState () const {return progMode;}
 
@@ -125,6 +198,15 @@ public:
 	template<MemType type>
 	void flush ();					// Дождаться завершения операций
 
+	template <MemType type>
+	void writePage (uint32_t address, const uint8_t* data, uint16_t length);	// Загрузить и записать страницы блока
+	template <MemType type>
+	void readBlock (uint32_t address, uint8_t* data, uint16_t length);
+	template <MemType type>
+	PageDiff comparePage (uint32_t address, const uint8_t* data, uint16_t length);
+	template <MemType type>
+	bool updatePage (uint32_t address, const uint8_t* data, uint16_t length);	// Записать, только если отличается
+
 	void fuseWriteLow (uint8_t bits);
 	void fuseWriteHigh (uint8_t bits);
 	void fuseWriteExt (uint8_t bits);
@@ -132,17 +214,40 @@ public:
 	uint8_t fuseReadHigh ();
 	uint8_t fuseReadExt ();
 
+	uint32_t readSignature ();		// 3 байта сигнатуры, например 0x1E9781
+	bool isKnownDevice () const { return knownDevice; }
+	uint16_t getFlashPageSize () const { return flashPageSize; }
+	uint8_t getEepromPageSize () const { return eepromPageSize; }
+	uint32_t getFlashSize () const { return uint32_t(flashSizeKb) * 1024; }	// 0 - неизвестна
+	uint16_t getEepromSize () const { return eepromSize; }
+	uint8_t getPrescale () const { return 2 << prescaleNumber; }
+	uint32_t getByteRate () const { return F_CPU / getPrescale () / 32; }
+
 	uint32_t position;
+	uint16_t pagesSkipped;			// Счётчик страниц, которые updatePage не стал записывать
 
 private:
 	void pinConfig ();				// Настройка пинов
 	void pinRelease ();				// Освобождение управления пинами
-	void spiConfig ();				// Конфигурация SPI передатчика
+	void spiConfig ();				// Конфигурация SPI передатчика с делителем prescaleNumber
 	void spiRelease ();				// Деконфигурация передатчика
 	bool enableProg ();				// Послать инструкцию перехода в режим программирования
 	uint8_t instruction (uint8_t b1, uint8_t b2, uint8_t b3, uint8_t b4); // Выполняет инструкцию, возвращает ответ
+	void waitReady (uint8_t timeout);	// Дождаться окончания записи, timeout - в десятых долях мсек
+	template <MemType type>
+	void commitPage (uint32_t address);	// Записать загруженную страницу, в которую входит address
+	void detectDevice (uint16_t signature);	// Выбрать геометрию памяти по сигнатуре
+	void loadExtended (uint8_t byte);	// Старший байт адреса слова flash (биты 16-23), если память больше 128 кБ
 
 	bool progMode;
+	bool knownDevice;
+	bool extendedAddress;
+	uint8_t extendedByte;				// Последний посланный в микросхему
+	uint16_t flashPageSize;
+	uint8_t eepromPageSize;
+	uint16_t flashSizeKb;
+	uint16_t eepromSize;
+	uint8_t prescaleNumber;				// Делитель SPI: 2 << prescaleNumber
 };
 
 
@@ -150,7 +255,9 @@ template <	volatile Bitfield<SpiStatusControl> Register::* control, volatile uin
 			Port Register::* port, uint8_t ssPin, uint8_t sckPin, uint8_t mosiPin, uint8_t misoPin,
 			Port Register::* resetPort, uint8_t resetPin	>
 ProgSpiSimple<control, dataReg, port, ssPin, sckPin, mosiPin, misoPin, resetPort, resetPin>::ProgSpiSimple()
-	: position (0)
+	: position (0), pagesSkipped (0), knownDevice (false), extendedAddress (false), extendedByte (0),
+	  flashPageSize (FLASH_PAGE_SIZE), eepromPageSize (EEPROM_PAGE_SIZE), flashSizeKb (0), eepromSize (0),
+	  prescaleNumber (0)
 {
 	rebootInWork();
 }
@@ -158,27 +265,48 @@ ProgSpiSimple<control, dataReg, port, ssPin, sckPin, mosiPin, misoPin, resetPort
 template <	volatile Bitfield<SpiStatusControl> Register::* control, volatile uint8_t Register::* dataReg,
 			Port Register::* port, uint8_t ssPin, uint8_t sckPin, uint8_t mosiPin, uint8_t misoPin,
 			Port Register::* resetPort, uint8_t resetPin	>
-bool ProgSpiSimple<control, dataReg, port, ssPin, sckPin, mosiPin, misoPin, resetPort, resetPin>::rebootInProg()
+bool ProgSpiSimple<control, dataReg, port, ssPin, sckPin, mosiPin, misoPin, resetPort, resetPin>::rebootInProg (uint32_t targetFrequency)
 {
 	pinConfig ();
-	spiConfig ();
 
-	for (uint8_t i = 0; i < 3; ++i)							// Заводим с трёх попыток
+	// SCK должна быть не больше четверти частоты соседа. Если она неизвестна, то быстрее F4 не начинаем:
+	// эхо и байт производителя могут пройти и на ненадёжной связи, которая потом испортит запись страниц
+	uint8_t fastest = 1;
+	if (targetFrequency != 0)
 	{
-		(reg.*resetPort).pin<resetPin>().out ();
-		(reg.*resetPort).pin<resetPin>() = 0;
-		_delay_loop_1 (2);
-		(reg.*resetPort).pin<resetPin>() = 1;
-		_delay_loop_1 (2);
-		(reg.*resetPort).pin<resetPin>() = 0;
-		_delay_ms (T_ST_PROG);
-
-		if ( enableProg() )
+		fastest = 0;
+		while ( fastest < 6 && (F_CPU / (2 << fastest)) * 4 > targetFrequency )
+			fastest ++;
+	}
+	if (prescaleNumber < fastest)
+		prescaleNumber = fastest;
+
+	for (; prescaleNumber <= 6; ++prescaleNumber)
+	{
+		spiConfig ();
+		for (uint8_t i = 0; i < 3; ++i)							// Заводим с трёх попыток
 		{
-			progMode = true;
-			return true;
+			(reg.*resetPort).pin<resetPin>().out ();
+			(reg.*resetPort).pin<resetPin>() = 0;
+			_delay_loop_1 (2);
+			(reg.*resetPort).pin<resetPin>() = 1;
+			_delay_loop_1 (2);
+			(reg.*resetPort).pin<resetPin>() = 0;
+			_delay_ms (T_ST_PROG);
+
+			if ( enableProg() )
+			{
+				uint32_t signature = readSignature ();
+				if ( (signature >> 16) == 0x1E )					// Байт производителя - связь устойчива на этой частоте
+				{
+					progMode = true;
+					detectDevice (signature);
+					return true;
+				}
+			}
 		}
 	}
+	prescaleNumber = 0;													// В следующий раз начать сначала
 	return false;
 }
 
@@ -198,7 +326,7 @@ template <	volatile Bitfield<SpiStatusControl> Register::* control, volatile uin
 void ProgSpiSimple<control, dataReg, port, ssPin, sckPin, mosiPin, misoPin, resetPort, resetPin>::erase()
 {
 	instruction (0xAC,0x80,0,0);
-	_delay_ms (T_WD_ERASE);
+	waitReady (T_WD_ERASE * 10);
 }
 
 template <	volatile Bitfield<SpiStatusControl> Register::* control, volatile uint8_t Register::* dataReg,
@@ -210,9 +338,12 @@ uint8_t ProgSpiSimple<control, dataReg, port, ssPin, sckPin, mosiPin, misoPin, r
 	static_assert (type == flash || type == eeprom, "Unknown memory type");
 	uint8_t data;
 	if (type == flash)
+	{
+		loadExtended (position >> 17);
 		data = instruction ( 0x20 | ((position & 0b1) << 3), position >> 9, position >> 1, 0 );
+	}
 	if (type == eeprom)
-		data = instruction ( 0xA0, (position >> 8) & 0x7, position, 0 );
+		data = instruction ( 0xA0, position >> 8, position, 0 );
 	position ++;
 	return data;
 }
@@ -235,15 +366,15 @@ void ProgSpiSimple<control, dataReg, port, ssPin, sckPin, mosiPin, misoPin, rese
 	static_assert (type == flash || type == eeprom, "Unknown memory type");
 	if (type == flash)
 	{
-		if (position % FLASH_PAGE_SIZE == 0)							// Если началась новая страница
+		if ((position & (flashPageSize - 1)) == 0)						// Если началась новая страница
 			flush<flash> ();
 		instruction ( 0x40 | ((position & 0b1) << 3), 0, position >> 1, data );
 	}
 	if (type == eeprom)
 	{
-		if (position % EEPROM_PAGE_SIZE == 0)							// Если началась новая страница
+		if ((position & (eepromPageSize - 1)) == 0)						// Если началась новая страница
 			flush<eeprom> ();
-		instruction ( 0xC1, 0, position & 0x7, data );
+		instruction ( 0xC1, 0, position & (eepromPageSize - 1), data );
 	}
 	position ++;
 }
@@ -264,25 +395,156 @@ template <	volatile Bitfield<SpiStatusControl> Register::* control, volatile uin
 template <	MemType type	>
 void ProgSpiSimple<control, dataReg, port, ssPin, sckPin, mosiPin, misoPin, resetPort, resetPin>::flush ()
 {
+	commitPage<type> (position-1);
+}
+
+template <	volatile Bitfield<SpiStatusControl> Register::* control, volatile uint8_t Register::* dataReg,
+			Port Register::* port, uint8_t ssPin, uint8_t sckPin, uint8_t mosiPin, uint8_t misoPin,
+			Port Register::* resetPort, uint8_t resetPin	>
+template <	MemType type	>
+void ProgSpiSimple<control, dataReg, port, ssPin, sckPin, mosiPin, misoPin, resetPort, resetPin>::writePage (uint32_t address, const uint8_t* data, uint16_t length)
+{
+	static_assert (type == flash || type == eeprom, "Unknown memory type");
+	uint16_t pageSize = type == flash ? flashPageSize : eepromPageSize;
+	while (length > 0)
+	{
+		uint16_t n = pageSize - (address & (pageSize - 1));			// До конца страницы
+		if (n > length)
+			n = length;
+		// В инструкции загрузки буфера страницы участвует только адрес внутри страницы: хватает 8 бит
+		uint8_t offset = address;
+		const uint8_t* end = data + n;
+		if (type == flash)
+			while (data != end)
+			{
+				instruction ( 0x40 | ((offset & 0b1) << 3), 0, offset >> 1, *data++ );
+				offset ++;
+			}
+		if (type == eeprom)
+			while (data != end)
+				instruction ( 0xC1, 0, (offset++) & (eepromPageSize - 1), *data++ );
+		commitPage<type> (address);
+		address += n;
+		length -= n;
+	}
+}
+
+template <	volatile Bitfield<SpiStatusControl> Register::* control, volatile uint8_t Register::* dataReg,
+			Port Register::* port, uint8_t ssPin, uint8_t sckPin, uint8_t mosiPin, uint8_t misoPin,
+			Port Register::* resetPort, uint8_t resetPin	>
+template <	MemType type	>
+void ProgSpiSimple<control, dataReg, port, ssPin, sckPin, mosiPin, misoPin, resetPort, resetPin>::readBlock (uint32_t address, uint8_t* data, uint16_t length)
+{
+	static_assert (type == flash || type == eeprom, "Unknown memory type");
+	uint8_t* end = data + length;
 	if (type == flash)
 	{
-		instruction ( 0x4C, (position-1) >> 9, ((position-1) >> 1) & 0x80, 0 );
-		_delay_ms (T_WD_FLASH);
+		uint16_t word = address >> 1;									// Младшие 16 бит адреса слова
+		uint8_t extended = address >> 17;								// Старшие - через Load Extended Address
+		loadExtended (extended);
+		if ((address & 0b1) && data != end)								// Начало с середины слова
+		{
+			*data++ = instruction ( 0x28, word >> 8, word, 0 );
+			if (++word == 0)
+				loadExtended (++extended);
+		}
+		while (data != end)
+		{
+			*data++ = instruction ( 0x20, word >> 8, word, 0 );
+			if (data == end)
+				break;
+			*data++ = instruction ( 0x28, word >> 8, word, 0 );
+			if (++word == 0)
+				loadExtended (++extended);
+		}
 	}
 	if (type == eeprom)
 	{
-		instruction( 0xC2, ((position-1) >> 8) & 0xf, (position-1) & 0xf8, 0 );
-		_delay_ms (T_WD_EEPROM);
+		uint16_t byte = address;
+		while (data != end)
+		{
+			*data++ = instruction ( 0xA0, byte >> 8, byte, 0 );
+			byte ++;
+		}
 	}
 }
 
+template <	volatile Bitfield<SpiStatusControl> Register::* control, volatile uint8_t Register::* dataReg,
+			Port Register::* port, uint8_t ssPin, uint8_t sckPin, uint8_t mosiPin, uint8_t misoPin,
+			Port Register::* resetPort, uint8_t resetPin	>
+template <	MemType type	>
+PageDiff ProgSpiSimple<control, dataReg, port, ssPin, sckPin, mosiPin, misoPin, resetPort, resetPin>::comparePage (uint32_t address, const uint8_t* data, uint16_t length)
+{
+	PageDiff diff = equal;
+	uint8_t chunk[EEPROM_PAGE_SIZE];
+	while (length > 0)
+	{
+		uint8_t n = length < sizeof(chunk) ? length : sizeof(chunk);
+		readBlock<type> (address, chunk, n);
+		for (uint8_t i = 0; i < n; ++i)
+			if (chunk[i] != data[i])
+			{
+				if (type == eeprom || (chunk[i] & data[i]) != data[i])	// Flash не может сменить 0 на 1 без отчистки
+					return type == eeprom ? programmable : needErase;
+				diff = programmable;
+			}
+		address += n;
+		data += n;
+		length -= n;
+	}
+	return diff;
+}
+
+template <	volatile Bitfield<SpiStatusControl> Register::* control, volatile uint8_t Register::* dataReg,
+			Port Register::* port, uint8_t ssPin, uint8_t sckPin, uint8_t mosiPin, uint8_t misoPin,
+			Port Register::* resetPort, uint8_t resetPin	>
+template <	MemType type	>
+bool ProgSpiSimple<control, dataReg, port, ssPin, sckPin, mosiPin, misoPin, resetPort, resetPin>::updatePage (uint32_t address, const uint8_t* data, uint16_t length)
+{
+	static_assert (type == flash || type == eeprom, "Unknown memory type");
+	if (type == flash)
+	{
+		PageDiff diff = comparePage<flash> (address, data, length);
+		if (diff == needErase)
+			return false;
+		if (diff == equal)
+			pagesSkipped ++;
+		else
+			writePage<flash> (address, data, length);
+	}
+	if (type == eeprom)
+	{
+		// Сравнение и загрузка за один проход: в буфер страницы попадают только изменившиеся байты,
+		// и только они будут записаны. Страница записывается, когда блок доходит до её конца
+		bool loaded = false;
+		uint16_t byte = address;
+		for (uint16_t i = 0; i < length; ++i, ++byte)
+		{
+			if ( instruction ( 0xA0, byte >> 8, byte, 0 ) != data[i] )
+			{
+				instruction ( 0xC1, 0, byte & (eepromPageSize - 1), data[i] );
+				loaded = true;
+			}
+			if ( ((byte + 1) & (eepromPageSize - 1)) == 0 || i + 1 == length )
+			{
+				if (loaded)
+					commitPage<eeprom> (byte);
+				else
+					pagesSkipped ++;
+				loaded = false;
+			}
+		}
+	}
+	return true;
+}
+
 template <	volatile Bitfield<SpiStatusControl> Register::* control, volatile uint8_t Register::* dataReg,
 			Port Register::* port, uint8_t ssPin, uint8_t sckPin, uint8_t mosiPin, uint8_t misoPin,
 			Port Register::* resetPort, uint8_t resetPin	>
 void ProgSpiSimple<control, dataReg, port, ssPin, sckPin, mosiPin, misoPin, resetPort, resetPin>::fuseWriteLow (uint8_t bits)
 {
 	instruction ( 0xAC, 0xA0, 0, bits );
-	_delay_ms (T_WD_FUSE);
+	waitReady (T_WD_FUSE * 10);
 }
 
 template <	volatile Bitfield<SpiStatusControl> Register::* control, volatile uint8_t Register::* dataReg,
@@ -291,7 +553,7 @@ template <	volatile Bitfield<SpiStatusControl> Register::* control, volatile uin
 void ProgSpiSimple<control, dataReg, port, ssPin, sckPin, mosiPin, misoPin, resetPort, resetPin>::fuseWriteHigh (uint8_t bits)
 {
 	instruction ( 0xAC, 0xA8, 0, bits );
-	_delay_ms (T_WD_FUSE);
+	waitReady (T_WD_FUSE * 10);
 }
 
 template <	volatile Bitfield<SpiStatusControl> Register::* control, volatile uint8_t Register::* dataReg,
@@ -300,7 +562,7 @@ template <	volatile Bitfield<SpiStatusControl> Register::* control, volatile uin
 void ProgSpiSimple<control, dataReg, port, ssPin, sckPin, mosiPin, misoPin, resetPort, resetPin>::fuseWriteExt (uint8_t bits)
 {
 	instruction ( 0xAC, 0xA4, 0, bits );
-	_delay_ms (T_WD_FUSE);
+	waitReady (T_WD_FUSE * 10);
 }
 
 template <	volatile Bitfield<SpiStatusControl> Register::* control, volatile uint8_t Register::* dataReg,
@@ -327,6 +589,17 @@ uint8_t ProgSpiSimple<control, dataReg, port, ssPin, sckPin, mosiPin, misoPin, r
 	return instruction ( 0x50, 0x08, 0, 0 );
 }
 
+template <	volatile Bitfield<SpiStatusControl> Register::* control, volatile uint8_t Register::* dataReg,
+			Port Register::* port, uint8_t ssPin, uint8_t sckPin, uint8_t mosiPin, uint8_t misoPin,
+			Port Register::* resetPort, uint8_t resetPin	>
+uint32_t ProgSpiSimple<control, dataReg, port, ssPin, sckPin, mosiPin, misoPin, resetPort, resetPin>::readSignature ()
+{
+	uint32_t signature = 0;
+	for (uint8_t i = 0; i < 3; ++i)
+		signature = (signature << 8) | instruction ( 0x30, 0, i, 0 );
+	return signature;
+}
+
 // private:
 
 template <	volatile Bitfield<SpiStatusControl> Register::* control, volatile uint8_t Register::* dataReg,
@@ -334,10 +607,8 @@ template <	volatile Bitfield<SpiStatusControl> Register::* control, volatile uin
 			Port Register::* resetPort, uint8_t resetPin	>
 void ProgSpiSimple<control, dataReg, port, ssPin, sckPin, mosiPin, misoPin, resetPort, resetPin>::pinConfig ()
 {
-	(reg.*port).pin<misoPin>().inPulled ();
-	(reg.*port).pin<mosiPin>().out ();
-	(reg.*port).pin<sckPin>().out ();
-	(reg.*port).pin<ssPin>().out ();									// SS пин конфигурируется на выход, чтобы при 0 на нём (вдруг - это вдруг случилось) не сбрасывался мастер-режим
+	PortPins<port, misoPin>::inPulled ();
+	PortPins<port, mosiPin, sckPin, ssPin>::out ();						// SS пин конфигурируется на выход, чтобы при 0 на нём (вдруг - это вдруг случилось) не сбрасывался мастер-режим
 }
 
 template <	volatile Bitfield<SpiStatusControl> Register::* control, volatile uint8_t Register::* dataReg,
@@ -346,10 +617,7 @@ template <	volatile Bitfield<SpiStatusControl> Register::* control, volatile uin
 void ProgSpiSimple<control, dataReg, port, ssPin, sckPin, mosiPin, misoPin, resetPort, resetPin>::pinRelease ()
 {
 	(reg.*resetPort).pin<resetPin>().inPulled ();
-	(reg.*port).pin<misoPin>().in ();
-	(reg.*port).pin<mosiPin>().in ();
-	(reg.*port).pin<sckPin>().in ();
-	(reg.*port).pin<ssPin>().in ();
+	PortPins<port, misoPin, mosiPin, sckPin, ssPin>::in ();
 }
 
 template <	volatile Bitfield<SpiStatusControl> Register::* control, volatile uint8_t Register::* dataReg,
@@ -360,7 +628,16 @@ void ProgSpiSimple<control, dataReg, port, ssPin, sckPin, mosiPin, misoPin, rese
 	Bitfield<SpiStatusControl> ctr (0);
 	ctr.enable = true;
 	ctr.master = true;
-	ctr.prescale = SpiStatusControl::Prescale::F4;
+	switch (prescaleNumber)
+	{
+	case 0:		ctr.prescale = SpiStatusControl::Prescale::F2;		break;
+	case 1:		ctr.prescale = SpiStatusControl::Prescale::F4;		break;
+	case 2:		ctr.prescale = SpiStatusControl::Prescale::F8;		break;
+	case 3:		ctr.prescale = SpiStatusControl::Prescale::F16;		break;
+	case 4:		ctr.prescale = SpiStatusControl::Prescale::F32;		break;
+	case 5:		ctr.prescale = SpiStatusControl::Prescale::F64;		break;
+	default:	ctr.prescale = SpiStatusControl::Prescale::F128;	break;
+	}
 	(reg.*control) = ctr;
 }
 
@@ -406,6 +683,76 @@ uint8_t ProgSpiSimple<control, dataReg, port, ssPin, sckPin, mosiPin, misoPin, r
 	return (reg.*dataReg);
 }
 
+template <	volatile Bitfield<SpiStatusControl> Register::* control, volatile uint8_t Register::* dataReg,
+			Port Register::* port, uint8_t ssPin, uint8_t sckPin, uint8_t mosiPin, uint8_t misoPin,
+			Port Register::* resetPort, uint8_t resetPin	>
+void ProgSpiSimple<control, dataReg, port, ssPin, sckPin, mosiPin, misoPin, resetPort, resetPin>::waitReady (uint8_t timeout)
+{
+	for (uint8_t i = 0; i < timeout; ++i)
+	{
+#ifdef PROGSPI_POLL_READY
+		if ( !(instruction (0xF0, 0, 0, 0) & 1) )						// Младший бит ответа: 1 - запись ещё идёт
+			return;
+#endif
+		_delay_us (100);
+	}
+}
+
+template <	volatile Bitfield<SpiStatusControl> Register::* control, volatile uint8_t Register::* dataReg,
+			Port Register::* port, uint8_t ssPin, uint8_t sckPin, uint8_t mosiPin, uint8_t misoPin,
+			Port Register::* resetPort, uint8_t resetPin	>
+template <	MemType type	>
+void ProgSpiSimple<control, dataReg, port, ssPin, sckPin, mosiPin, misoPin, resetPort, resetPin>::commitPage (uint32_t address)
+{
+	if (type == flash)
+	{
+		loadExtended (address >> 17);
+		instruction ( 0x4C, address >> 9, address >> 1, 0 );			// Биты адреса внутри страницы микросхема не учитывает
+		waitReady (T_WD_FLASH * 10);
+	}
+	if (type == eeprom)
+	{
+		instruction( 0xC2, address >> 8, address & ~(eepromPageSize - 1), 0 );
+		waitReady (T_WD_EEPROM * 10);
+	}
+}
+
+template <	volatile Bitfield<SpiStatusControl> Register::* control, volatile uint8_t Register::* dataReg,
+			Port Register::* port, uint8_t ssPin, uint8_t sckPin, uint8_t mosiPin, uint8_t misoPin,
+			Port Register::* resetPort, uint8_t resetPin	>
+void ProgSpiSimple<control, dataReg, port, ssPin, sckPin, mosiPin, misoPin, resetPort, resetPin>::detectDevice (uint16_t signature)
+{
+	knownDevice = false;
+	flashPageSize = FLASH_PAGE_SIZE;
+	eepromPageSize = EEPROM_PAGE_SIZE;
+	flashSizeKb = 0;
+	eepromSize = 0;
+	for (const Device& d : devices)
+		if ( pgm_read_word (&d.signature) == signature )
+		{
+			knownDevice = true;
+			flashSizeKb = pgm_read_word (&d.flashSizeKb);
+			flashPageSize = pgm_read_word (&d.flashPageSize);
+			eepromSize = pgm_read_word (&d.eepromSize);
+			eepromPageSize = pgm_read_byte (&d.eepromPageSize);
+			break;
+		}
+	extendedAddress = flashSizeKb > 128;
+	extendedByte = 0;											// После сброса расширенный адрес равен 0
+}
+
+template <	volatile Bitfield<SpiStatusControl> Register::* control, volatile uint8_t Register::* dataReg,
+			Port Register::* port, uint8_t ssPin, uint8_t sckPin, uint8_t mosiPin, uint8_t misoPin,
+			Port Register::* resetPort, uint8_t resetPin	>
+void ProgSpiSimple<control, dataReg, port, ssPin, sckPin, mosiPin, misoPin, resetPort, resetPin>::loadExtended (uint8_t byte)
+{
+	if ( extendedAddress && byte != extendedByte )
+	{
+		instruction ( 0x4D, 0, byte, 0 );
+		extendedByte = byte;
+	}
+}
+
 } // namespace close
 
 
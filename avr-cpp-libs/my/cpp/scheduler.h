@@ -146,10 +146,12 @@ uint8_t Scheduler<Clock, clock, size, InTime>::runIn (Command command, InTime ti
 		num ++;
 		uint8_t sreg = SREG; // Remember last state
 		cli ();
+		PROFILE_ENTER(CriticalProfile::scheduler);
 
 		if (t.active != 1 && t.blocked != 1) // Empty and unblocked
 		{
 			t.blocked = 1;
+			PROFILE_EXIT(CriticalProfile::scheduler);
 			SREG = sreg;
 
 			t.time = clock.getTime() + time;
@@ -161,7 +163,10 @@ uint8_t Scheduler<Clock, clock, size, InTime>::runIn (Command command, InTime ti
 			return num;
 		}
 		else
+		{
+			PROFILE_EXIT(CriticalProfile::scheduler);
 			SREG = sreg;
+		}
 	}
 	return false;
 }
@@ -0,0 +1,168 @@
+/*
+ * spi-master.h
+ *
+ * Очередь передач SPI на прерываниях
+ * **********************************
+ *
+ *  ~~~ Проблема: ~~~
+ *  Внешние АЦП и flash сидят на одной шине SPI, и каждое обращение ждёт transferComplete в цикле на каждом байте.
+ *  Пока идёт обмен, основной цикл стоит, а устройства, обращающиеся к шине из разных мест, мешают друг другу.
+ *
+ *  ~~~ Решение: ~~~
+ *  1. Передача описывается структурой SpiTransfer: пин выбора устройства (cs), режим и частота SPI,
+ *     буферы передачи и приёма, длина и комманда done с флагом hasDone.
+ *  2. transfer() копирует описание в очередь фиксированного размера. Если шина свободна, то передача начинается сразу.
+ *  3. Каждый байт передаётся из прерывания SPI_STC. По окончании передачи cs поднимается, done (если hasDone) ставится в Dispatcher,
+ *     и из того же прерывания начинается следующая передача из очереди - без простоя шины.
+ *  4. Очередь обслуживается по порядку постановки, поэтому ни одно устройство не ждёт дольше, чем занимают шину
+ *     уже стоящие в очереди передачи.
+ *
+ *  ~~~ Интерфейс: ~~~
+ *  SpiMaster< control, dataReg, port, ssPin, sckPin, mosiPin, misoPin, size > spi;
+ *  - size - число передач в очереди
+ *  SpiTransfer t { csPort, csPin, SpiMaster<...>::mode (prescale, phase, leadingEdge), tx, rx, length, hasDone, done };
+ *  - tx == 0 - передаются 0xFF, rx == 0 - принятое не сохраняется
+ *  - hasDone == false - done не ставится в Dispatcher, hasDone и done можно не указывать
+ *  spi.transfer (t);		// false - очередь заполнена
+ *  spi.isBusy ();
+ *  spi.getCount ();			// Число передач в очереди, включая текущую
+ *
+ *  ~~~ Ограничения: ~~~
+ *  1. Буферы tx и rx должны жить до выполнения done.
+ *  2. cs каждого устройства в покое должен быть настроен на выход с 1 (например, PortPins<...>::set и ::out).
+ *  3. Занимает прерывание SPI_STC. Вместе с ProgSpiAsync не используется.
+ *
+ *  ~~~ Пример использования: ~~~
+	SpiMaster<&Register::spiStatusControl, &Register::spiData, &Register::portB, 0, 1, 2, 3, 4> spi;
+
+	uint8_t adcCommand[3] = {0x06, 0x00, 0x00};
+	uint8_t adcAnswer[3];
+
+	void adcReady (uint16_t)
+	{
+		uint16_t value = ((adcAnswer[1] & 0x0F) << 8) | adcAnswer[2];
+		// ...
+	}
+
+	void adcStart ()
+	{
+		spi.transfer ( SpiTransfer{ &Register::portE, 5,
+									decltype(spi)::mode (SpiStatusControl::F16, SpiStatusControl::DataSampleOnLeadingEdge, SpiStatusControl::Rising),
+									adcCommand, adcAnswer, 3, true,
+									Command{SoftIntHandler::from_function<&adcReady>(), 0} } );
+	}
+ *
+ */
+
+#ifndef SPI_MASTER_H_
+#define SPI_MASTER_H_
+
+#include <cpp/universal.h>
+#include <cpp/io.h>
+#include <cpp/interrupt-dynamic.h>
+#include <cpp/dispatcher.h>
+
+struct SpiTransfer
+{
+	Port Register::* csPort;
+	uint8_t csPin;
+	Bitfield<SpiStatusControl> mode;	// SpiMaster::mode ()
+	const uint8_t* tx;
+	uint8_t* rx;
+	uint16_t length;
+	bool hasDone;						// Пустой Delegate не отличить от заданного, поэтому наличие done указывается явно
+	Command done;
+};
+
+template <	volatile Bitfield<SpiStatusControl> Register::* control, volatile uint8_t Register::* dataReg,
+			Port Register::* port, uint8_t ssPin, uint8_t sckPin, uint8_t mosiPin, uint8_t misoPin,
+			uint8_t size	>
+class SpiMaster
+{
+public:
+	SpiMaster ()
+		: head (0), tail (0), count (0), index (0)
+	{
+		SPI_STC_handler = InterruptHandler::from_method <SpiMaster, &SpiMaster::interruptHandler>(this);
+
+		PortPins<port, misoPin>::in ();
+		PortPins<port, mosiPin, sckPin, ssPin>::out ();					// SS на выходе, чтобы 0 на нём не сбрасывал режим мастера
+	}
+
+	static Bitfield<SpiStatusControl> mode (SpiStatusControl::Prescale prescale,
+											SpiStatusControl::Phase phase = SpiStatusControl::DataSampleOnLeadingEdge,
+											SpiStatusControl::LeadingEdge leadingEdge = SpiStatusControl::Rising,
+											SpiStatusControl::DataOrder dataOrder = SpiStatusControl::MsbFirst)
+	{
+		Bitfield<SpiStatusControl> ctr (0);
+		ctr.prescale = prescale;
+		ctr.phase = phase;
+		ctr.leadingEdge = leadingEdge;
+		ctr.dataOrder = dataOrder;
+		ctr.master = true;
+		ctr.enable = true;
+		ctr.interruptEnable = true;
+		return ctr;
+	}
+
+	bool transfer (const SpiTransfer& t)
+	{
+		if ( t.length == 0 )
+			return false;
+		PROFILE_ATOMIC(CriticalProfile::spi)
+		{
+			if ( count == size )
+				return false;
+			queue[head] = t;
+			head = head + 1 == size ? 0 : head + 1;
+			if ( count++ == 0 )
+				start ();
+		}
+		return true;
+	}
+
+	bool isBusy () const { return count != 0; }
+	uint8_t getCount () const { return count; }
+
+private:
+	SpiTransfer queue[size];
+	uint8_t head;
+	uint8_t tail;					// Текущая передача
+	volatile uint8_t count;
+	uint16_t index;					// Номер передаваемого байта
+
+	void start ()
+	{
+		const SpiTransfer& t = queue[tail];
+		(reg.*control) = t.mode;
+		(reg.*t.csPort).clear (1 << t.csPin);
+		(reg.*t.csPort).out (1 << t.csPin);
+		index = 0;
+		(reg.*dataReg) = t.tx ? t.tx[0] : 0xFF;
+	}
+
+	void interruptHandler ()
+	{
+		PROFILE_SCOPE (CriticalProfile::spiInterrupt);
+		SpiTransfer& t = queue[tail];
+		uint8_t answer = (reg.*dataReg);
+		if ( t.rx )
+			t.rx[index] = answer;
+		if ( ++index < t.length )
+		{
+			(reg.*dataReg) = t.tx ? t.tx[index] : 0xFF;
+			return;
+		}
+
+		(reg.*t.csPort).set (1 << t.csPin);
+		if ( t.hasDone )
+			dispatcher.add (t.done);
+		tail = tail + 1 == size ? 0 : tail + 1;
+		if ( --count != 0 )
+			start ();
+		else
+			(reg.*control).interruptEnable = false;
+	}
+};
+
+#endif /* SPI_MASTER_H_ */
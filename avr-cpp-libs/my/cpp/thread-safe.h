@@ -56,6 +56,7 @@
 #define THREAD_SAFE_H_
 
 #include <cpp/Chizhov/AVR/atomic.h>
+#include <cpp/critical-profile.h>
 
 template<typename T>
 union Safe
@@ -89,18 +90,18 @@ public:
 	Safe& operator<<= (const volatile T& a)
 	{
 		T volatile temp = a;
-		ATOMIC volatileX =  temp;
+		PROFILE_ATOMIC(CriticalProfile::safe) volatileX =  temp;
 		return *this;
 	}
 	Safe& operator<<= (const T& a)
 	{
 		T temp = a;
-		ATOMIC volatileX =  temp;
+		PROFILE_ATOMIC(CriticalProfile::safe) volatileX =  temp;
 		return *this;
 	}
 	Safe& operator<<= (const Safe& a)
 	{
-		ATOMIC volatileX = a.volatileX;
+		PROFILE_ATOMIC(CriticalProfile::safe) volatileX = a.volatileX;
 		return *this;
 	}
 	template<typename Tt> friend Tt& operator<<= (Tt& a, const Safe<Tt>& b);
@@ -109,59 +110,59 @@ public:
 	Safe& operator&= (const volatile T& a)
 	{
 		T volatile temp = a;
-		ATOMIC volatileX &= temp;
+		PROFILE_ATOMIC(CriticalProfile::safe) volatileX &= temp;
 		return *this;
 	}
 	Safe& operator&= (const T& a)
 	{
 		T temp = a;
-		ATOMIC volatileX &= temp;
+		PROFILE_ATOMIC(CriticalProfile::safe) volatileX &= temp;
 		return *this;
 	}
 	Safe& operator&= (const Safe& a)
 	{
-		ATOMIC volatileX &= a.volatileX;
+		PROFILE_ATOMIC(CriticalProfile::safe) volatileX &= a.volatileX;
 		return *this;
 	}
 	Safe& operator^= (const volatile T& a)
 	{
 		T volatile temp = a;
-		ATOMIC volatileX ^= temp;
+		PROFILE_ATOMIC(CriticalProfile::safe) volatileX ^= temp;
 		return *this;
 	}
 	Safe& operator^= (const T& a)
 	{
 		T temp = a;
-		ATOMIC volatileX ^= temp;
+		PROFILE_ATOMIC(CriticalProfile::safe) volatileX ^= temp;
 		return *this;
 	}
 	Safe& operator^= (const Safe& a)
 	{
-		ATOMIC volatileX ^= a.volatileX;
+		PROFILE_ATOMIC(CriticalProfile::safe) volatileX ^= a.volatileX;
 		return *this;
 	}
 	Safe& operator|= (const volatile T& a)
 	{
 		T volatile temp = a;
-		ATOMIC volatileX |= temp;
+		PROFILE_ATOMIC(CriticalProfile::safe) volatileX |= temp;
 		return *this;
 	}
 	Safe& operator|= (const T& a)
 	{
 		T temp = a;
-		ATOMIC volatileX |= temp;
+		PROFILE_ATOMIC(CriticalProfile::safe) volatileX |= temp;
 		return *this;
 	}
 	Safe& operator|= (const Safe& a)
 	{
-		ATOMIC volatileX |= a.volatileX;
+		PROFILE_ATOMIC(CriticalProfile::safe) volatileX |= a.volatileX;
 		return *this;
 	}
 	// Аналог приведения типа
 	T operator +() const
 	{
 		T temp;
-		ATOMIC temp = volatileX;
+		PROFILE_ATOMIC(CriticalProfile::safe) temp = volatileX;
 		return temp;
 	}
 
@@ -175,7 +176,7 @@ template<typename T>
 inline T& operator<<= (T& a, const Safe<T>& b)
 {
 	T temp;
-	ATOMIC temp = b.volatileX;
+	PROFILE_ATOMIC(CriticalProfile::safe) temp = b.volatileX;
 	a = temp;
 	return a;
 }
@@ -183,7 +184,7 @@ template<typename T>
 inline volatile T& operator<<= (volatile T& a, const Safe<T>& b)
 {
 	volatile T temp;
-	ATOMIC temp = b.volatileX;
+	PROFILE_ATOMIC(CriticalProfile::safe) temp = b.volatileX;
 	a = temp;
 	return a;
 }
@@ -227,4 +228,106 @@ inline uint8_t Safe<uint8_t>::operator +() const
 }
 
 
+/*
+ *  Переменные с последовательным счётчиком (seqlock)
+ *  *************************************************
+ *
+ *  ~~~ Проблема: ~~~
+ *  Safe<T> копирует значение под ATOMIC. Для структур в 8-32 байта это длинное окно cli,
+ *  на время которого задерживаются прерывания CAN и таймеров.
+ *
+ *  ~~~ Решение: ~~~
+ *  Для данных с единственным писателем (обычно это обработчик прерывания) используется счётчик sequence:
+ *  1. Писатель увеличивает sequence перед записью (становится нечётным) и после записи (снова чётный).
+ *  2. Читатель запоминает sequence, копирует данные и сравнивает sequence с запомненным.
+ *     Если счётчик был нечётным или изменился, то копирование повторяется.
+ *  Прерывания при этом не запрещаются ни писателем, ни читателем.
+ *
+ *  ~~~ Интерфейс: ~~~
+ *  Аналогичен Safe: оператор <<= обеспечивает безопасную запись и извлечение значений,
+ *  унарный + возвращает безопасно считанную копию.
+ *
+ *  ~~~ Ограничения: ~~~
+ *  1. Писатель должен быть один. Если писателей несколько, то запись необходимо защищать снаружи.
+ *  2. Читатель не должен прерывать писателя: писатель в прерывании, читатель в основном цикле.
+ *     В обратной ситуации читатель в прерывании будет бесконечно ждать окончания записи.
+ *  3. Чтение может повторяться, поэтому его время не ограничено сверху, если писатель пишет непрерывно.
+ *
+ *  ~~~ Пример использования: ~~~
+	struct Telemetry { uint16_t speed; uint32_t distance; uint8_t flags[4]; };
+	SeqSafe<Telemetry> telemetry;
+
+	ISR: telemetry <<= current;		// Запись из прерывания
+
+	Telemetry t;
+	t <<= telemetry;				// Чтение в основном цикле без cli
+ *
+ */
+template<typename T>
+class SeqSafe
+{
+public:
+	SeqSafe ()
+		: sequence (0), data () {}
+	SeqSafe (const T& a)
+		: sequence (0), data (a) {}
+
+	// Безопасная запись. Выполняется единственным писателем.
+	SeqSafe& operator<<= (const T& a)
+	{
+		sequence ++;
+		asm volatile ("" ::: "memory");
+		copy ( (uint8_t*)&data, (const uint8_t*)&a );
+		asm volatile ("" ::: "memory");
+		sequence ++;
+		return *this;
+	}
+
+	// Безопасное чтение
+	T operator +() const
+	{
+		T temp;
+		read (temp);
+		return temp;
+	}
+
+	template<typename Tt> friend Tt& operator<<= (Tt& a, const SeqSafe<Tt>& b);
+
+	// Номер последней записи. Нечётный - идёт запись.
+	uint8_t getSequence () const { return sequence; }
+
+private:
+	static_assert (sizeof(T) < 256, "SeqSafe copies byte by byte with uint8_t counter");
+
+	volatile uint8_t sequence;
+	T data;
+
+	void read (T& out) const
+	{
+		uint8_t seq;
+		do
+		{
+			while ( (seq = sequence) & 1 );
+			asm volatile ("" ::: "memory");
+			copy ( (uint8_t*)&out, (const uint8_t*)&data );
+			asm volatile ("" ::: "memory");
+		}
+		while ( seq != sequence );
+	}
+
+	static void copy (uint8_t* to, const uint8_t* from)
+	{
+		for (uint8_t i = 0; i < sizeof(T); ++i)
+			to[i] = ((const volatile uint8_t*)from)[i];
+	}
+};
+
+template<typename T>
+inline T& operator<<= (T& a, const SeqSafe<T>& b)
+{
+	b.read (a);
+	return a;
+}
+
+
 #endif /* THREAD_SAFE_H_ */
@@ -205,9 +205,11 @@ public:
 		else if ( compare1024 	!= max ) { comp = compare1024;	prsc = ClockType::Prescale1024; }
 
 		(reg.*compare) = comp;
-		(reg.*control).clockType = prsc;
-		(reg.*control).waveform = ControlType::ClearOnCompare;
-		(reg.*control).outputMode = ControlType::OutPinDisconnect;
+		(reg.*control).modify ( [&](ControlType& c) {
+			c.clockType = prsc;
+			c.waveform = ControlType::ClearOnCompare;
+			c.outputMode = ControlType::OutPinDisconnect;
+		} );
 //		(reg.*interruptMask).CompInterrupt = true;
 
 		// Устанавливаем обработчик
@@ -311,9 +313,11 @@ public:
 		// Если обработчик не будет задан, но таймер будет переведён в активный режим,
 		// то хотя бы вызывать прерывание как можно реже
 		(reg.*compare) = maxForType<CompareType> ();
-		(reg.*control).clockType = ClockType::Prescale1024;
-		(reg.*control).waveform = ControlType::ClearOnCompare;
-		(reg.*control).outputMode = ControlType::OutPinDisconnect;
+		(reg.*control).modify ( [](ControlType& c) {
+			c.clockType = ClockType::Prescale1024;
+			c.waveform = ControlType::ClearOnCompare;
+			c.outputMode = ControlType::OutPinDisconnect;
+		} );
 //		(reg.*interruptMask).CompInterrupt = true;
 	}
 	AlarmAdjust (const uint32_t& tMks, InterruptHandler interruptHandler_)
@@ -347,9 +351,12 @@ public:
 		}
 
 		(reg.*compare) = betterCompare;
-		(reg.*control).clockType = selectClockType(betterPrescale);
-		(reg.*control).waveform = ControlType::ClearOnCompare;
-		(reg.*control).outputMode = ControlType::OutPinDisconnect;
+		ClockType clockType = selectClockType(betterPrescale);
+		(reg.*control).modify ( [&](ControlType& c) {
+			c.clockType = clockType;
+			c.waveform = ControlType::ClearOnCompare;
+			c.outputMode = ControlType::OutPinDisconnect;
+		} );
 		(reg.*interruptMask).CompInterrupt = true;
 
 		return betterT;
@@ -486,15 +493,19 @@ public:
 		return (+time);
 	}
 
-private:
-	ClockSampleAlarm alarm;
-	Safe<Time> time;
-
+	// Обработчик прерывания. Открыт для INTERRUPT_STATIC (interrupt-static.h)
 	void incTime ()
 	{
-		time ++;
+		{
+			PROFILE_SCOPE(CriticalProfile::clockInterrupt);
+			time ++;
+		}
 		sei ();
 	}
+
+private:
+	ClockSampleAlarm alarm;
+	Safe<Time> time;
 };
 
 #endif /* TIMERS_H_ */
@@ -0,0 +1,120 @@
+/*
+ * triple-buffer.h
+ *
+ * Тройной буфер для передачи снимков состояния из прерывания в основной цикл
+ * **************************************************************************
+ *
+ *  ~~~ Проблема: ~~~
+ *  Обработчик прерывания формирует целую запись состояния (развёртка АЦП, вектор скорости по CAN),
+ *  а основной цикл забирает её со своей частотой. С Safe<T> или буферами CanDat::data
+ *  каждая передача требует либо копирования под cli, либо допускает "разорванные" данные.
+ *
+ *  ~~~ Решение: ~~~
+ *  1. Три экземпляра T: один заполняет писатель (back), один читает читатель (front),
+ *     третий (middle) хранит последний опубликованный снимок.
+ *  2. publish() меняет местами back и middle, latest() меняет местами middle и front.
+ *     Номер middle и флаг "свежести" хранятся в одном байте state.
+ *  3. Под запретом прерываний выполняется только обмен индексов (несколько тактов),
+ *     данные под cli никогда не копируются. Ни одна из сторон не ждёт другую.
+ *
+ *  ~~~ Интерфейс: ~~~
+ *  Писатель (обычно прерывание):
+ *  - back() возвращает ссылку на буфер для заполнения
+ *  - publish() публикует заполненный буфер; publish(value) копирует value в буфер и публикует
+ *  Читатель (основной цикл):
+ *  - latest() возвращает ссылку на последний опубликованный снимок.
+ *    Ссылка действительна до следующего вызова latest().
+ *  - isFresh() сообщает, есть ли снимок, ещё не забранный latest()
+ *
+ *  ~~~ Ограничения: ~~~
+ *  Один писатель и один читатель. Промежуточные снимки, не забранные читателем, теряются - это
+ *  сделано намеренно, читатель всегда получает самый новый.
+ *
+ *  ~~~ Пример использования: ~~~
+	struct Sweep { uint16_t channel[8]; };
+	TripleBuffer<Sweep> sweep;
+
+	void adcSample ()				// Вызывается по таймеру Clock/Alarm или из прерывания АЦП
+	{
+		for (uint8_t i = 0; i < 8; ++i)
+			sweep.back().channel[i] = adc[i];
+		sweep.publish ();
+	}
+
+	void speedReceived (uint16_t pointer)	// rxHandler CanDat, выполняется диспетчером
+	{
+		speed.publish ( *(const Speed*)pointer );
+	}
+
+	int main ()
+	{
+		for (;;)
+			if ( sweep.isFresh() )
+				process ( sweep.latest() );
+	}
+ *
+ */
+
+#ifndef TRIPLE_BUFFER_H_
+#define TRIPLE_BUFFER_H_
+
+#include <avr/io.h>
+#include <cpp/Chizhov/AVR/atomic.h>
+
+template<typename T>
+class TripleBuffer
+{
+public:
+	TripleBuffer ()
+		: backIndex (0), frontIndex (1), state (2)
+	{}
+
+	// ---- Сторона писателя ----
+	T& back () { return buffer[backIndex]; }
+
+	void publish ()
+	{
+		uint8_t published = backIndex;
+		ATOMIC
+		{
+			backIndex = state & indexMask;
+			state = published | freshFlag;
+		}
+	}
+	void publish (const T& value)
+	{
+		buffer[backIndex] = value;
+		publish ();
+	}
+
+	// ---- Сторона читателя ----
+	const T& latest ()
+	{
+		if ( state & freshFlag ) // Флаг снимает только читатель, поэтому повторная проверка не нужна
+		{
+			uint8_t released = frontIndex;
+			ATOMIC
+			{
+				frontIndex = state & indexMask;
+				state = released;
+			}
+		}
+		return buffer[frontIndex];
+	}
+
+	bool isFresh () const { return state & freshFlag; }
+
+private:
+	enum : uint8_t
+	{
+		indexMask = 0x03,
+		freshFlag = 0x80
+	};
+
+	T buffer[3];
+	uint8_t backIndex;		// Принадлежит писателю
+	uint8_t frontIndex;		// Принадлежит читателю
+	volatile uint8_t state;	// Номер middle и флаг свежести
+};
+
+#endif /* TRIPLE_BUFFER_H_ */
@@ -66,7 +66,7 @@ inline OutputClass horrible_cast(const InputClass input){
 	// If the compile fails here, it means the compiler has peculiar
 	// unions which would prevent the cast from working.
 	typedef int ERROR_CantUseHorrible_cast[sizeof(InputClass)==sizeof(u)
-		&& sizeof(InputClass)==sizeof(OutputClass) ? 1 : -1];
+		&& sizeof(InputClass)==sizeof(OutputClass) ? 1 : -1] __attribute__ ((unused));
 	u.in = input;
 	return u.out;
 }
@@ -109,7 +109,7 @@ public:
 	Base base;
 
 private:
-	void init (uint8_t n) {}
+	void init (uint8_t) {}
 
 	template< typename... Args >
 	void init (uint8_t n, uint8_t byte, Args... bytes)
@@ -141,7 +141,7 @@ public:
 		{ return *((uint8_t*)this + byteNumber); }
 
 private:
-	void init (uint8_t n) {}
+	void init (uint8_t) {}
 
 	template< typename... Args >
 	void init (uint8_t n, uint8_t byte, Args... bytes)
@@ -168,7 +168,7 @@ void reboot ()
 	while (0);
 }
 
-//
+/*
 //#define PortDeclare(Letter) \
 //	struct Port ## Letter{\
 //		static volatile uint8_t &port()\
@@ -223,7 +223,7 @@ void reboot ()
 //	  inline void operator() (uint8_t ); \
 //	}; \
 //F ## Name Name;
-//
+*/
 
 
 template <typename RetType, typename BaseType, typename ExpType>
@@ -238,4 +238,12 @@ constexpr TestType maxForType (const TestType a = 0)
 	return 	( pow<TestType>(2, sizeof(TestType)*8 -1) - 1 ) * 2 + 1;
 }
 
+// Параметр функции вида typename Identity<T>::Type не участвует в выводе T,
+// и аргумент к нему приводится как к обычному параметру (например, int к uint16_t)
+template <typename T>
+struct Identity
+{
+	typedef T Type;
+};
+
 #endif /* UNIVERSAL_H_ */
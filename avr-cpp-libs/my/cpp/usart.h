@@ -0,0 +1,222 @@
+/*
+ * usart.h
+ *
+ * Драйвер USART на прерываниях с кольцевыми буферами
+ * **************************************************
+ *
+ *  ~~~ Проблема: ~~~
+ *  Диагностический канал работает опросом: каждый байт ждёт dataRegEmpty, а приём теряет байты,
+ *  пока основной цикл занят другим.
+ *
+ *  ~~~ Решение: ~~~
+ *  1. Передача и приём идут через кольцевые буферы размером txSize и rxSize (степени двойки, не более 256).
+ *     У каждого кольца один писатель и один читатель (основной цикл и прерывание), поэтому запрет прерываний
+ *     не нужен: писатель меняет только head, читатель - только tail.
+ *  2. Прерывание dataRegEmpty (UDRE) включается, когда в кольцо передачи положен байт,
+ *     и выключается самим обработчиком, когда кольцо опустело. Без данных прерывание не вызывается.
+ *  3. Делитель частоты и doubleSpeed выбираются при компиляции: из двух вариантов берётся тот, у которого ошибка
+ *     скорости меньше. Если ошибка больше 2%, то компиляция останавливается.
+ *  4. Если задан разделитель кадров (setFrameHandler), то обработчик приёма на каждом принятом разделителе
+ *     ставит в Dispatcher комманду с числом байт в кольце приёма. Основной цикл получает одно сообщение на кадр
+ *     вместо опроса каждого байта.
+ *
+ *  ~~~ Интерфейс: ~~~
+ *  Usart< channel, baud, txSize, rxSize > usart;
+ *  - channel - Usart0 или Usart1
+ *  usart.put (c);				// false - кольцо передачи заполнено
+ *  usart.write (data, length);	// Сколько байт поставлено
+ *  usart.get (c);				// false - принятых байт нет
+ *  usart.getCount ();			// Число принятых байт в кольце
+ *  usart.isOverflow ();			// Были потеряны принятые байты (кольцо было заполнено). Сбрасывается чтением
+ *  usart.setFrameHandler (delimiter, command);
+ *  usart.clearFrameHandler ();
+ *
+ *  ~~~ Ограничения: ~~~
+ *  1. put/write/get - только из основного цикла (или только из одного прерывания).
+ *  2. Формат кадра 8N1.
+ *  3. Занимает прерывания USARTn_RX и USARTn_UDRE.
+ *
+ *  ~~~ Пример использования: ~~~
+	Usart<Usart1, 57600, 64, 64> usart;
+
+	void onLine (uint16_t length)
+	{
+		char line[64];
+		uint8_t c, n = 0;
+		while ( n < length && usart.get (c) )
+			line[n++] = c;
+		// ...
+	}
+
+	int main ()
+	{
+		usart.setFrameHandler ( '\n', Command{SoftIntHandler::from_function<&onLine>(), 0} );
+		sei ();
+		for (;;)
+			dispatcher.invoke ();
+	}
+ *
+ */
+
+#ifndef USART_H_
+#define USART_H_
+
+#include <cpp/universal.h>
+#include <cpp/io.h>
+#include <cpp/interrupt-dynamic.h>
+#include <cpp/dispatcher.h>
+
+template <	volatile Bitfield<UsartControl> Register::* control,
+			volatile Bitfield<UsartBaudRate> Register::* baudRate,
+			volatile uint8_t Register::* dataReg,
+			InterruptHandler* rxInterrupt, InterruptHandler* dataRegEmptyInterrupt,
+			uint32_t baud, uint16_t txSize, uint16_t rxSize >
+class Usart
+{
+private:
+	// Без этой проверки divisor переполнится, а errorPromille поделит на 0, и вместо static_assert будет непонятная ошибка
+	static constexpr bool baudValid = baud != 0 && baud <= F_CPU / 8;
+
+	static constexpr uint16_t divisor (uint8_t samples)
+	{
+		return baudValid ? (F_CPU + uint32_t(samples) * baud / 2) / (uint32_t(samples) * baud) - 1 : 0;
+	}
+	static constexpr uint32_t errorPromille (uint8_t samples)	// Отклонение скорости в тысячных
+	{
+		return 	!baudValid ? 0
+				: F_CPU / (uint32_t(samples) * (divisor (samples) + 1)) > baud
+				? (F_CPU / (uint32_t(samples) * (divisor (samples) + 1)) - baud) * 1000 / baud
+				: (baud - F_CPU / (uint32_t(samples) * (divisor (samples) + 1))) * 1000 / baud;
+	}
+
+	static constexpr bool doubleSpeed = errorPromille (8) < errorPromille (16) && divisor (8) < 4096;
+	static constexpr uint16_t ubrr = doubleSpeed ? divisor (8) : divisor (16);
+
+	static_assert ( baudValid, "Baud rate is too high for given F_CPU: more than F_CPU/8" );
+	static_assert ( (doubleSpeed ? errorPromille (8) : errorPromille (16)) <= 20,
+					"Baud rate error is more than 2% for given F_CPU. Try to change baud rate." );
+	static_assert ( ubrr < 4096, "Baud rate is too low for given F_CPU" );
+	static_assert ( txSize != 0 && txSize <= 256 && (txSize & (txSize - 1)) == 0, "txSize must be a power of 2, not more than 256" );
+	static_assert ( rxSize != 0 && rxSize <= 256 && (rxSize & (rxSize - 1)) == 0, "rxSize must be a power of 2, not more than 256" );
+
+public:
+	Usart ()
+		: txHead (0), txTail (0), rxHead (0), rxTail (0), overflow (false), frameEnable (false)
+	{
+		*rxInterrupt = InterruptHandler::from_method <Usart, &Usart::rxHandler>(this);
+		*dataRegEmptyInterrupt = InterruptHandler::from_method <Usart, &Usart::dataRegEmptyHandler>(this);
+
+		(reg.*baudRate) = uint16_t (ubrr);
+		(reg.*control).modify ( [](UsartControl& c)
+			{
+				c.txComplete = 0;			// UCSRnA записывается обратно: 1 в TXC сбросила бы флаг,
+				c.frameError = 0;			// а FE, DOR и UPE при записи должны быть 0
+				c.dataOverRunError = 0;
+				c.parityError = 0;
+				c.doubleSpeed = doubleSpeed;
+				c.charSize0bit = 1;			// 8 бит
+				c.charSize1bit = 1;
+				c.charSize2bit = 0;
+				c.rxCompleteInterrupt = true;
+				c.rxEnable = true;
+				c.txEnable = true;
+			} );
+	}
+
+	bool put (uint8_t c)
+	{
+		uint8_t next = (txHead + 1) & (txSize - 1);
+		if ( next == txTail )
+			return false;
+		txBuffer[txHead] = c;
+		txHead = next;
+		controlB () |= dataRegEmptyInterruptBit;		// Обработчик только выключает прерывание и только при пустом кольце - гонки нет
+		return true;
+	}
+
+	uint8_t write (const uint8_t* data, uint8_t length)
+	{
+		uint8_t n = 0;
+		while ( n < length && put (data[n]) )
+			n ++;
+		return n;
+	}
+
+	bool get (uint8_t& c)
+	{
+		if ( rxTail == rxHead )
+			return false;
+		c = rxBuffer[rxTail];
+		rxTail = (rxTail + 1) & (rxSize - 1);
+		return true;
+	}
+
+	uint8_t getCount () const { return (rxHead - rxTail) & (rxSize - 1); }
+
+	bool isOverflow ()
+	{
+		bool o = overflow;
+		overflow = false;
+		return o;
+	}
+
+	void setFrameHandler (uint8_t delimiter_, const Command& frame_)
+	{
+		frameEnable = false;
+		delimiter = delimiter_;
+		frame = frame_;
+		frameEnable = true;
+	}
+	void clearFrameHandler () { frameEnable = false; }
+
+	static constexpr uint16_t baudDivisor = ubrr;
+	static constexpr bool baudDoubleSpeed = doubleSpeed;
+
+private:
+	uint8_t txBuffer[txSize];
+	uint8_t rxBuffer[rxSize];
+	volatile uint8_t txHead;		// Пишет основной цикл
+	volatile uint8_t txTail;		// Пишет прерывание
+	volatile uint8_t rxHead;		// Пишет прерывание
+	volatile uint8_t rxTail;		// Пишет основной цикл
+	volatile bool overflow;
+	volatile bool frameEnable;
+	uint8_t delimiter;
+	Command frame;
+
+	// UCSRnB отдельным байтом: поле UsartControl читает и пишет все 4 байта, в том числе флаги UCSRnA
+	static constexpr uint8_t dataRegEmptyInterruptBit = 1 << 5;	// UDRIE
+	static volatile uint8_t& controlB () { return ((volatile uint8_t*) &(reg.*control))[1]; }
+
+	void rxHandler ()
+	{
+		uint8_t c = (reg.*dataReg);
+		uint8_t next = (rxHead + 1) & (rxSize - 1);
+		if ( next == rxTail )
+		{
+			overflow = true;
+			return;
+		}
+		rxBuffer[rxHead] = c;
+		rxHead = next;
+		if ( frameEnable && c == delimiter )
+			dispatcher.add ( Command{frame.handler, getCount ()} );
+	}
+
+	void dataRegEmptyHandler ()
+	{
+		uint8_t tail = txTail;
+		if ( tail == txHead )
+		{
+			controlB () &= ~dataRegEmptyInterruptBit;
+			return;
+		}
+		(reg.*dataReg) = txBuffer[tail];
+		txTail = (tail + 1) & (txSize - 1);
+	}
+};
+
+#define Usart0	&Register::usart0Control, &Register::usart0BaudRate, &Register::usart0Data, &USART0_RX_handler, &USART0_UDRE_handler
+#define Usart1	&Register::usart1Control, &Register::usart1BaudRate, &Register::usart1Data, &USART1_RX_handler, &USART1_UDRE_handler
+
+#endif /* USART_H_ */
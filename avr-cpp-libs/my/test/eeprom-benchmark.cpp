@@ -0,0 +1,112 @@
+/*
+ * eeprom-benchmark.cpp
+ *
+ * Производительность записи в eeprom на модели (host/eeprom-model.h)
+ * ******************************************************************
+ *
+ *  Три типичных способа записи одних и тех же данных:
+ *  1. blocking - Eeprom<uint32_t>::operator= на каждое изменение счётчика
+ *  2. unblock  - updateUnblock того же счётчика раз в 1 мсек основного цикла, при отказе - повтор в следующем цикле
+ *  3. queue    - EepromQueue::update таблицы калибровки 64 байта, в которой меняется 6 байт
+ *  Для каждого: байт записано и пропущено (update - запрошено, но совпало с eeprom), модельное время, скорость записи,
+ *  время простоя основного цикла в ожидании eeprom.
+ *  Тест проваливается, если модель видит нарушение протокола регистров,
+ *  если содержимое eeprom не совпало с ожидаемым или записано больше байт, чем запрошено.
+ *
+ *  Сборка и запуск - run.sh
+ */
+
+#include <cpp/eeprom.h>
+#include <test-check.h>
+
+struct Calibration { uint8_t table[64]; };
+
+Eeprom<uint32_t> counter EEMEM;
+Eeprom<Calibration> calibrationStored EEMEM;
+EepromQueue<4> eepromQueue;
+
+static uint64_t started;
+
+// requested - байт передано на запись (в режиме update), пропущено - те из них, которые модель не записала
+static void report (const char* name, uint32_t changes, uint64_t requested)
+{
+	const EepromModel::Statistics& s = eepromModel.getStatistics ();
+	uint64_t time = eepromModel.time () - started;
+	uint64_t skipped = requested > s.writes ? requested - s.writes : 0;
+	printf ("%-9s %5u changes: written %6llu, skipped %6llu (%3u%%), time %7.2f s, %6.1f B/s, main loop stall %7.2f s\n",
+			name, (unsigned)changes, (unsigned long long)s.writes, (unsigned long long)skipped,
+			requested ? unsigned(100 * skipped / requested) : 0,
+			time / 1e6, time ? s.writes * 1e6 / time : 0.0, s.stall / 1e6);
+	check (s.protocolErrors == 0, "register protocol violated");
+	check (s.writes <= requested, "more bytes written than requested");
+}
+
+static void begin ()
+{
+	eepromModel.finish ();
+	eepromModel.resetStatistics ();
+	started = eepromModel.time ();
+}
+
+static volatile bool saved;
+static void calibrationSaved (uint16_t) { saved = true; }
+
+int main ()
+{
+	const uint32_t changes = 1000;
+
+	// 1. Блокирующая запись
+	begin ();
+	for (uint32_t i = 1; i <= changes; ++i)
+	{
+		counter = i;
+		eepromModel.run (100);						// Остальная работа основного цикла
+	}
+	eepromModel.finish ();
+	report ("blocking", changes, changes * sizeof(uint32_t));
+	check (uint32_t(counter) == changes, "blocking: wrong value");
+
+	// 2. Неблокирующая запись, основной цикл 1 мсек
+	begin ();
+	uint32_t value = changes, rejected = 0;
+	for (uint32_t i = 1; i <= changes; )
+	{
+		if ( counter.updateUnblock (value + i) )
+			i ++;
+		else
+			rejected ++;
+		eepromModel.run (1000);
+	}
+	eepromModel.finish ();
+	report ("unblock", changes, changes * sizeof(uint32_t));
+	printf ("          rejected (eeprom busy) %u\n", (unsigned)rejected);
+	check (uint32_t(counter) == value + changes, "unblock: wrong value");
+
+	// 3. Очередь, таблица 64 байта
+	begin ();
+	Calibration c;
+	for (uint8_t i = 0; i < sizeof(c.table); ++i)
+		c.table[i] = i;
+	calibrationStored = c;
+	begin ();
+	const uint32_t tables = 100;
+	for (uint32_t n = 0; n < tables; ++n)
+	{
+		for (uint8_t k = 0; k < 6; ++k)
+			c.table[(n * 11 + k * 7) & 63] ++;
+		saved = false;
+		check (eepromQueue.update (calibrationStored, c, Command{SoftIntHandler::from_function<&calibrationSaved>(), 0}),
+			   "queue: request rejected");
+		while ( !saved )
+		{
+			eepromModel.run (1000);
+			dispatcher.invoke ();
+		}
+	}
+	report ("queue", tables, tables * sizeof(Calibration));
+	check (eepromModel.getStatistics().stall == 0, "queue: main loop stalled");
+	Calibration stored = calibrationStored;
+	check (memcmp (&stored, &c, sizeof(c)) == 0, "queue: wrong table");
+
+	return testFailed;
+}
@@ -0,0 +1,142 @@
+/*
+ * eeprom-ring-wear.cpp
+ *
+ * Износ и восстановление EepromRing (eeprom-ring.h) на модели eeprom (host/eeprom-model.h)
+ * ****************************************************************************************
+ *
+ *  1. Износ: одна и та же последовательность значений пишется в EepromRing и в обычный Eeprom<uint32_t>.
+ *     Модель считает записи каждой ячейки. Множитель ресурса - отношение максимального износа ячейки
+ *     Eeprom<uint32_t> к максимальному износу ячейки кольца, он должен быть не меньше records.
+ *  2. Перезапуск: после записей кольцо создаётся заново в дочернем процессе из того же содержимого eeprom
+ *     и должно найти последнее значение, в том числе после переполнения sequence.
+ *  3. Частые изменения: значение меняется каждую 1 мсек, быстрее записи. Записей меньше, чем изменений,
+ *     после перезапуска читается последнее значение.
+ *  4. Пропадание питания: на каждой записи первых двух кругов питание пропадает на каждом байте записи.
+ *     После перезапуска значение - старое или новое, и кольцо продолжает писать.
+ *
+ *  Сборка и запуск - run.sh
+ */
+
+#include <cpp/eeprom-ring.h>
+#include <eeprom-test.h>
+#include <sys/mman.h>
+
+enum { records = 64 };
+
+typedef EepromQueue<4> Queue;
+Queue eepromQueue;
+typedef EepromRing<uint32_t, records, Queue, eepromQueue> Ring;
+
+EepromRingStorage<uint32_t, records> odometerStorage EEMEM;
+Eeprom<uint32_t> plainCounter EEMEM;
+
+static uint32_t maxWear (const void* p, uint16_t length)
+{
+	uint32_t m = 0;
+	for (uint16_t i = 0; i < length; ++i)
+		if ( eepromModel.wearOf (eepromModel.address (p) + i) > m )
+			m = eepromModel.wearOf (eepromModel.address (p) + i);
+	return m;
+}
+
+// Образ eeprom, который дочерний процесс оставляет для следующего запуска
+static uint8_t* image = (uint8_t*) mmap (0, 4096, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+
+// Новый запуск программы с содержимым eeprom (или image): 0 - прочитано expected, 1 - alternative, 2 - другое
+static int reboot (uint32_t expected, uint32_t alternative, bool fromImage = false)
+{
+	return EepromModel::inChild ([=] () -> int
+		{
+			if ( fromImage )
+				eepromModel.load (image);
+			Ring* ring = new Ring (odometerStorage);
+			return ring->get () == expected ? 0 : ring->get () == alternative ? 1 : 2;
+		});
+}
+
+// Питание пропадает на байте cut записи value. 0 - после перезапуска старое значение, 1 - новое,
+// 2 - ни то, ни другое, 3 - после перезапуска кольцо не пишет
+static int powerCut (Ring& ring, uint32_t value, uint8_t cut, uint32_t seed)
+{
+	uint32_t old = ring.get ();
+	EepromModel::inChild ([&] () -> int
+		{
+			eepromModel.powerCutAt (cut, seed);
+			ring = value;
+			settle ();
+			eepromModel.save (image);
+			return 0;
+		});
+
+	int found = reboot (old, value, true);
+	if ( found == 2 )
+		return 2;
+	return EepromModel::inChild ([=] () -> int
+		{
+			eepromModel.load (image);
+			Ring* again = new Ring (odometerStorage);
+			*again = value + 1;
+			settle ();
+			return reboot (value + 1, value + 1) == 0 ? found : 3;
+		});
+}
+
+int main ()
+{
+	// Чистая eeprom
+	uint8_t erased[4096];
+	memset (erased, 0xFF, sizeof(erased));
+	eepromModel.load (erased);
+
+	Ring& odometer = *new Ring (odometerStorage);
+	check (odometer.get () == 0, "erased eeprom: value is not Type()");
+
+	// 1, 2, 4. Износ, перезапуск, пропадание питания
+	const uint32_t changes = records * 100;
+	uint32_t cuts[4] = {0};
+	for (uint32_t i = 1; i <= changes; ++i)
+	{
+		if ( i <= 2 * records )
+			for (uint8_t cut = 1; cut <= sizeof(Ring::Record); ++cut)
+				for (uint32_t seed = 1; seed <= 3; ++seed)
+					cuts[powerCut (odometer, i, cut, seed)] ++;
+
+		odometer = i;
+		plainCounter = i;
+		check (settle (), "write did not finish");
+		if ( i % 97 == 0 || i == changes )
+			check (reboot (i, i) == 0, "reboot: last value not found");
+	}
+
+	uint32_t ringWear = maxWear (&odometerStorage, sizeof(odometerStorage));
+	uint32_t plainWear = maxWear (&plainCounter, sizeof(plainCounter));
+	printf ("eeprom-ring-wear: %u changes, max cell wear: Eeprom %u, EepromRing<%u> %u, endurance x%.1f\n",
+			(unsigned)changes, (unsigned)plainWear, (unsigned)records, (unsigned)ringWear,
+			ringWear ? double(plainWear) / ringWear : 0.0);
+	check (plainWear >= ringWear * records, "endurance multiplier is less than records");
+	check (eepromModel.getStatistics().protocolErrors == 0, "register protocol violated");
+
+	printf ("                  power cut: old value %u, new value %u, wrong value %u, ring stuck %u\n",
+			(unsigned)cuts[0], (unsigned)cuts[1], (unsigned)cuts[2], (unsigned)cuts[3]);
+	check (cuts[2] == 0, "power cut: value is neither old nor new");
+	check (cuts[3] == 0, "power cut: ring does not write after reboot");
+	check (cuts[0] != 0 && cuts[1] != 0, "power cut: cut never hit the write");
+
+	// 3. Частые изменения
+	uint64_t before = eepromModel.getStatistics().writes;
+	const uint32_t ticks = 1000;
+	for (uint32_t t = 1; t <= ticks; ++t)
+	{
+		odometer = changes + t;
+		eepromModel.run (1000);
+		dispatcher.invoke ();
+		odometer.sync ();
+	}
+	check (settle (), "write did not finish");
+	uint32_t written = (eepromModel.getStatistics().writes - before + sizeof(Ring::Record) - 1) / sizeof(Ring::Record);
+	printf ("                  %u changes 1 ms apart: about %u records written\n", (unsigned)ticks, (unsigned)written);
+	check (written < ticks / 2, "frequent changes: writes are not merged");
+	check (reboot (changes + ticks, changes + ticks) == 0, "frequent changes: last value lost");
+
+	return testFailed;
+}
@@ -0,0 +1,133 @@
+/*
+ * eeprom-transaction-fuzz.cpp
+ *
+ * Пропадание питания во время EepromTransaction::commit (eeprom-transaction.h) на модели eeprom
+ * *********************************************************************************************
+ *
+ *  Все поля конфигурации вычисляются из номера поколения, поэтому смесь двух поколений видна сразу.
+ *  Для каждого поколения (первое - на чистой eeprom) и для каждого байта записи commit
+ *  питание пропадает на этом байте (ячейка получает случайное значение, несколько seed).
+ *  Образ eeprom передаётся следующему запуску, который проверяет:
+ *  - конфигурация целиком старая (до первого commit - isValid () == false) или целиком новая;
+ *  - после этого commit следующего поколения проходит и читается после ещё одного перезапуска.
+ *
+ *  Сборка и запуск - run.sh
+ */
+
+#include <cpp/eeprom-transaction.h>
+#include <eeprom-test.h>
+#include <sys/mman.h>
+
+struct Config
+{
+	uint16_t canId;
+	uint8_t baud;
+	int16_t offset[4];
+	uint32_t serial;
+};
+
+typedef EepromQueue<4> Queue;
+Queue eepromQueue;
+typedef EepromTransaction<Config, Queue, eepromQueue> Transaction;
+
+EepromTransactionStorage<Config> configStorage EEMEM;
+
+static Config make (uint32_t generation)
+{
+	Config c;
+	c.canId = uint16_t(generation * 0x101);
+	c.baud = uint8_t(generation * 3);
+	for (uint8_t i = 0; i < 4; ++i)
+		c.offset[i] = int16_t(generation * 7 + i);
+	c.serial = generation;
+	return c;
+}
+
+// Поколение конфигурации: 0 - не записана (isValid () == false), -1 - смесь поколений
+static int32_t generationOf (const Transaction& t)
+{
+	if ( !t.isValid () )
+		return 0;
+	const Config& v = t.get ();
+	Config c = make (v.serial);
+	bool same = v.canId == c.canId && v.baud == c.baud;
+	for (uint8_t i = 0; i < 4; ++i)
+		same = same && v.offset[i] == c.offset[i];
+	return same ? int32_t(v.serial) : -1;
+}
+
+static bool commit (Transaction& t, uint32_t generation)
+{
+	t.begin () = make (generation);
+	return t.commit () && settle ();
+}
+
+// Содержимое eeprom, которое процесс с пропавшим питанием оставляет следующему запуску
+static uint8_t* image = (uint8_t*) mmap (0, 4096, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+
+// 0 - после перезапуска старое поколение, 1 - новое, 2 - другое или смесь, 3 - следующий commit не прочитался
+static int powerCut (Transaction& config, uint32_t generation, uint64_t cut, uint32_t seed)
+{
+	EepromModel::inChild ([&] () -> int
+		{
+			eepromModel.powerCutAt (cut, seed);
+			commit (config, generation);
+			eepromModel.save (image);
+			return 0;
+		});
+
+	return EepromModel::inChild ([=] () -> int
+		{
+			eepromModel.load (image);
+			Transaction* t = new Transaction (configStorage);
+			int32_t found = generationOf (*t);
+			if ( found != int32_t(generation - 1) && found != int32_t(generation) )
+				return 2;
+			if ( !commit (*t, generation + 1) )
+				return 3;
+			int next = EepromModel::inChild ([=] () -> int
+				{
+					Transaction* again = new Transaction (configStorage);
+					return generationOf (*again) == int32_t(generation + 1) ? 0 : 1;
+				});
+			if ( next != 0 )
+				return 3;
+			return found == int32_t(generation) ? 1 : 0;
+		});
+}
+
+int main ()
+{
+	uint8_t erased[4096];
+	memset (erased, 0xFF, sizeof(erased));
+	eepromModel.load (erased);
+
+	Transaction& config = *new Transaction (configStorage);
+	check (!config.isValid (), "erased eeprom: configuration is valid");
+
+	// Байт записи в одном commit: область и commit
+	const uint64_t bytes = sizeof(Transaction::Area) + 1;
+	const uint32_t generations = 8, seeds = 4;
+	uint32_t result[4] = {0};
+	for (uint32_t g = 1; g <= generations; ++g)
+	{
+		for (uint64_t cut = 1; cut <= bytes; ++cut)
+			for (uint32_t seed = 1; seed <= seeds; ++seed)
+				result[powerCut (config, g, cut, seed)] ++;
+
+		uint64_t before = eepromModel.getWriteNumber ();
+		check (commit (config, g), "commit failed");
+		check (eepromModel.getWriteNumber () - before == bytes, "commit writes an unexpected number of bytes");
+		check (generationOf (config) == int32_t(g), "committed configuration is not in ram");
+	}
+
+	printf ("eeprom-transaction-fuzz: %u power cuts: old configuration %u, new %u, torn %u, next commit lost %u\n",
+			(unsigned)(generations * bytes * seeds), (unsigned)result[0], (unsigned)result[1],
+			(unsigned)result[2], (unsigned)result[3]);
+	check (result[2] == 0, "torn configuration after power cut");
+	check (result[3] == 0, "commit after power cut is lost");
+	check (result[1] != 0, "power cut never hit the commit byte");
+	check (eepromModel.getStatistics().protocolErrors == 0, "register protocol violated");
+
+	return testFailed;
+}
@@ -0,0 +1,54 @@
+/*
+ * avr/eeprom.h для сборки тестов на компьютере: функции avr-libc поверх модели eeprom (eeprom-model.h)
+ */
+
+#ifndef HOST_AVR_EEPROM_H_
+#define HOST_AVR_EEPROM_H_
+
+#include <stddef.h>
+#include "../eeprom-model.h"
+
+static inline void eeprom_busy_wait () { eepromModel.busyWait (); }
+static inline uint8_t eeprom_is_ready () { return !eepromModel.isBusy (); }
+
+static inline void eeprom_read_block (void* to, const void* from, size_t length)
+{
+	for (size_t i = 0; i < length; ++i)
+		((uint8_t*)to)[i] = eepromModel.read (eepromModel.address (from) + i);
+}
+static inline uint8_t eeprom_read_byte (const uint8_t* from)
+{
+	return eepromModel.read (eepromModel.address (from));
+}
+static inline uint16_t eeprom_read_word (const uint16_t* from)
+{
+	uint16_t v;
+	eeprom_read_block (&v, from, sizeof(v));
+	return v;
+}
+static inline uint32_t eeprom_read_dword (const uint32_t* from)
+{
+	uint32_t v;
+	eeprom_read_block (&v, from, sizeof(v));
+	return v;
+}
+
+static inline void eeprom_write_block (const void* from, void* to, size_t length)
+{
+	for (size_t i = 0; i < length; ++i)
+		eepromModel.write (eepromModel.address (to) + i, ((const uint8_t*)from)[i]);
+}
+static inline void eeprom_write_byte (uint8_t* to, uint8_t value) { eeprom_write_block (&value, to, 1); }
+static inline void eeprom_write_word (uint16_t* to, uint16_t value) { eeprom_write_block (&value, to, 2); }
+static inline void eeprom_write_dword (uint32_t* to, uint32_t value) { eeprom_write_block (&value, to, 4); }
+
+static inline void eeprom_update_block (const void* from, void* to, size_t length)
+{
+	for (size_t i = 0; i < length; ++i)
+		eepromModel.update (eepromModel.address (to) + i, ((const uint8_t*)from)[i]);
+}
+static inline void eeprom_update_byte (uint8_t* to, uint8_t value) { eeprom_update_block (&value, to, 1); }
+static inline void eeprom_update_word (uint16_t* to, uint16_t value) { eeprom_update_block (&value, to, 2); }
+static inline void eeprom_update_dword (uint32_t* to, uint32_t value) { eeprom_update_block (&value, to, 4); }
+
+#endif /* HOST_AVR_EEPROM_H_ */
@@ -0,0 +1,16 @@
+/*
+ * avr/interrupt.h для сборки тестов на компьютере
+ */
+
+#ifndef HOST_AVR_INTERRUPT_H_
+#define HOST_AVR_INTERRUPT_H_
+
+#include <avr/io.h>
+
+// Атрибут signal векторов (INTERRUPT_POINTER_DECLARE) есть только у AVR
+#pragma GCC diagnostic ignored "-Wattributes"
+
+static inline void cli () { hostInterrupts (false); }
+static inline void sei () { hostInterrupts (true); }
+
+#endif /* HOST_AVR_INTERRUPT_H_ */
@@ -0,0 +1,74 @@
+/*
+ * avr/io.h для сборки тестов на компьютере
+ *
+ *  Прерывание AVR на компьютере - сигнал SIGALRM: он так же прерывает основной поток в любом месте.
+ *  cli/sei и запись бита I в SREG блокируют и разрешают этот сигнал.
+ *  Вектора прерываний - обычные функции, тест вызывает их сам (или из обработчика сигнала).
+ */
+
+#ifndef HOST_AVR_IO_H_
+#define HOST_AVR_IO_H_
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <signal.h>
+
+#ifndef F_CPU
+#define F_CPU 16000000UL
+#endif
+
+#define RAMEND	0x10FF
+#define E2END	0xFFF
+
+static inline void hostInterrupts (bool enable)
+{
+	sigset_t set;
+	sigemptyset (&set);
+	sigaddset (&set, SIGALRM);
+	sigprocmask (enable ? SIG_UNBLOCK : SIG_BLOCK, &set, 0);
+}
+static inline bool hostInterruptsEnabled ()
+{
+	sigset_t set;
+	sigprocmask (SIG_BLOCK, 0, &set);
+	return !sigismember (&set, SIGALRM);
+}
+
+struct HostSreg
+{
+	operator uint8_t () const { return hostInterruptsEnabled () ? 0x80 : 0; }
+	HostSreg& operator= (uint8_t s)
+	{
+		hostInterrupts (s & 0x80);
+		return *this;
+	}
+};
+HostSreg hostSreg;
+#define SREG hostSreg
+
+volatile uint16_t hostProfileCounter;
+#define TCNT3 hostProfileCounter
+
+// Регистры лежат в памяти, а не по адресу 0x20 (REGISTER_BASE в cpp/io.h). Страница целиком их,
+// модели устройств (eeprom-model.h) отображают на её место свою. Тест - одна единица трансляции
+uint8_t hostRegisterSpace[4096] __attribute__ ((aligned (4096)));
+#define REGISTER_BASE hostRegisterSpace
+
+inline uint32_t abs (uint32_t a) { return a; }	// avr-libc: abs(int), в коде библиотеки применяется к беззнаковым
+
+#define INT0_vect			__vector_1
+#define TIMER0_COMP_vect	__vector_2
+#define TIMER2_COMP_vect	__vector_3
+#define TIMER1_COMPA_vect	__vector_4
+#define TIMER3_COMPA_vect	__vector_5
+#define CANIT_vect			__vector_6
+#define SPI_STC_vect		__vector_7
+#define EE_READY_vect		__vector_8
+#define USART0_RX_vect		__vector_9
+#define USART0_UDRE_vect	__vector_10
+#define USART1_RX_vect		__vector_11
+#define USART1_UDRE_vect	__vector_12
+#define TIMER0_OVF_vect		__vector_13
+#define ADC_vect			__vector_14
+
+#endif /* HOST_AVR_IO_H_ */
@@ -0,0 +1,18 @@
+/*
+ * avr/pgmspace.h для сборки тестов на компьютере: flash и ram - одна память
+ */
+
+#ifndef HOST_AVR_PGMSPACE_H_
+#define HOST_AVR_PGMSPACE_H_
+
+#include <stdint.h>
+
+// Число чтений flash - для оценки времени поиска в тестах (на AVR каждое чтение - lpm, 3 такта)
+uint32_t hostFlashReads;
+
+#define PROGMEM
+#define pgm_read_byte(a)	(hostFlashReads ++, *(const uint8_t*)(a))
+#define pgm_read_word(a)	(hostFlashReads ++, *(const uint16_t*)(a))
+#define pgm_read_dword(a)	(hostFlashReads ++, *(const uint32_t*)(a))
+
+#endif /* HOST_AVR_PGMSPACE_H_ */
@@ -0,0 +1,15 @@
+/*
+ * avr/wdt.h для сборки тестов на компьютере
+ */
+
+#ifndef HOST_AVR_WDT_H_
+#define HOST_AVR_WDT_H_
+
+#define WDTO_15MS	0
+#define WDTO_2S		7
+
+static inline void wdt_enable (int) {}
+static inline void wdt_reset () {}
+static inline void wdt_disable () {}
+
+#endif /* HOST_AVR_WDT_H_ */
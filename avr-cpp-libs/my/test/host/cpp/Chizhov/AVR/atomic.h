@@ -0,0 +1,28 @@
+/*
+ * ATOMIC для сборки тестов на компьютере: то же, что у Чижова, но cli через avr/interrupt.h
+ */
+
+#pragma once
+
+#include <avr/interrupt.h>
+
+class DisableInterrupts
+{
+public:
+	DisableInterrupts()
+	{
+		_sreg = SREG;
+		cli ();
+	}
+	~DisableInterrupts()
+	{
+		SREG = _sreg;
+	}
+	operator bool()
+	{return false;}
+private:
+	uint8_t _sreg;
+};
+
+#define ATOMIC if(DisableInterrupts di = DisableInterrupts()){}else
+#define _ATOMIC_ (DisableInterrupts di = DisableInterrupts()) ? (0) :
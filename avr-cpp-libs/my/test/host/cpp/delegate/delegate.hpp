@@ -0,0 +1,7 @@
+/*
+ * delegate.hpp для сборки тестов на компьютере: делегат srutil (cpp/delegate) - сторонний код,
+ * его предупреждения (-Wextra) тестами не проверяются
+ */
+
+#pragma GCC system_header
+#include_next <cpp/delegate/delegate.hpp>
@@ -0,0 +1,306 @@
+/*
+ * eeprom-model.h
+ *
+ * Модель eeprom AVR для тестов на компьютере
+ * ******************************************
+ *
+ *  ~~~ Задача: ~~~
+ *  Выполнять Eeprom, EepromQueue и построенные на них модули без изменений, как на микроконтроллере:
+ *  через регистры eepromControl, eepromData, eepromAddress (EECR, EEDR, EEAR) и прерывание EE_READY,
+ *  с временем записи байта, пропуском одинаковых байт в режиме update и пропаданием питания посреди записи.
+ *
+ *  ~~~ Решение: ~~~
+ *  1. Обращения к регистрам перехватывает RegisterTrap (register-trap.h): после каждой команды,
+ *     обратившейся к регистрам, модель получает их новые значения.
+ *  2. Поведение регистров:
+ *     - EERE - eepromData = ячейка[eepromAddress]. Чтение во время записи - ошибка протокола;
+ *     - EEWE при уже установленном EEMWE - запись байта. EEWE держится writeTime модельного времени.
+ *       EEWE без EEMWE не действует. EEMWE сбрасывается через одно обращение к регистрам (на AVR - 4 такта);
+ *     - изменение eepromAddress или eepromData во время записи - ошибка протокола.
+ *  3. Время модельное (мксек). run (time) продвигает его. Пока установлен EERIE, нет записи и прерывания
+ *     разрешены, вызывается EE_READY_handler (прерывание по уровню, как на AVR).
+ *  4. Функции avr-libc (eeprom_read_*, eeprom_update_*, eeprom_write_*, eeprom_busy_wait) работают
+ *     с той же моделью. Время их ожидания готовности - простой основного цикла (stall).
+ *  5. powerCutAt (n) - n-я запись байта (считая с 1) портит свою ячейку случайным значением,
+ *     дальше eeprom не пишется, а isPowerLost () == true.
+ *  6. Переменные EEMEM лежат в секции host_eeprom. Адрес в eeprom - смещение от её начала.
+ *
+ *  ~~~ Ограничения: ~~~
+ *  1. Только x86-64 Linux.
+ *  2. EEPROM_MIRROR на компьютере не работает: копия индексируется 16-битным адресом.
+ */
+
+#ifndef HOST_EEPROM_MODEL_H_
+#define HOST_EEPROM_MODEL_H_
+
+#include <stdint.h>
+#include <string.h>
+#include <sys/wait.h>
+
+#include <cpp/io.h>
+#include <cpp/interrupt-dynamic.h>
+#include "register-trap.h"
+
+#define EEMEM __attribute__ ((section ("host_eeprom")))
+extern "C" uint8_t __start_host_eeprom[] __attribute__ ((weak));
+extern "C" uint8_t __stop_host_eeprom[] __attribute__ ((weak));
+
+class EepromModel : public RegisterTrap
+{
+public:
+	enum
+	{
+		readEnable			= 1 << 0,
+		writeEnable			= 1 << 1,
+		masterWriteEnable	= 1 << 2,
+		interruptEnable		= 1 << 3
+	};
+
+	struct Statistics
+	{
+		uint64_t writes;			// Записано байт
+		uint64_t writesEqual;		// Из них записано значение, уже бывшее в ячейке (лишний износ)
+		uint64_t reads;
+		uint64_t interrupts;		// Вызовов EE_READY
+		uint64_t stall;				// Мксек в ожидании готовности внутри функций avr-libc
+		uint64_t protocolErrors;
+	};
+
+	uint32_t writeTime;				// Мксек на запись байта
+
+	EepromModel ()
+		: writeTime (4500), now (0), busy (false), masterArmed (0), writeNumber (0), cutAt (0), powerLost (false),
+		  seed (1), statistics (), wear (0)
+	{
+		wear = (uint32_t*) calloc (size () + 1, sizeof (uint32_t));
+		snapshot ();
+	}
+
+	// Ячейки eeprom
+	uint8_t* cells () const { return __start_host_eeprom; }
+	uint16_t size () const { return __stop_host_eeprom - __start_host_eeprom; }
+	uint16_t address (const volatile void* p) const { return (const volatile uint8_t*)p - cells(); }
+	uint32_t wearOf (uint16_t address) const { return wear[address]; }
+	uint32_t maxWear () const
+	{
+		uint32_t m = 0;
+		for (uint16_t i = 0; i < size (); ++i)
+			if ( wear[i] > m )
+				m = wear[i];
+		return m;
+	}
+
+	uint64_t time () const { return now; }
+	bool isBusy () const { return busy; }
+	const Statistics& getStatistics () const { return statistics; }
+	void resetStatistics () { statistics = Statistics (); }
+
+	void powerCutAt (uint64_t write, uint32_t seed_ = 1)
+	{
+		cutAt = writeNumber + write;
+		seed = seed_;
+	}
+	bool isPowerLost () const { return powerLost; }
+	uint64_t getWriteNumber () const { return writeNumber; }
+
+	// Продвигает модельное время, выполняя записи и прерывания EE_READY
+	void run (uint64_t time)
+	{
+		uint64_t end = now + time;
+		uint16_t idle = 0;
+		while ( !powerLost )
+		{
+			if ( busy )
+			{
+				if ( doneAt > end )
+					break;
+				now = doneAt;
+				complete ();
+			}
+			else if ( (control () & interruptEnable) && hostInterruptsEnabled () )
+			{
+				statistics.interrupts ++;
+				EE_READY_handler ();
+				if ( !busy && ++idle == 1000 )	// Обработчик не пишет и не выключает прерывание
+				{
+					statistics.protocolErrors ++;
+					break;
+				}
+			}
+			else
+				break;
+		}
+		now = end;
+	}
+
+	// Ждёт окончания всех записей (и всего, что начнут прерывания). false - пропало питание
+	bool finish (uint64_t limit = 60000000)
+	{
+		uint64_t end = now + limit;
+		while ( !powerLost && now < end && (busy || ((control () & interruptEnable) && hostInterruptsEnabled ())) )
+			run (busy ? doneAt - now : 0);
+		return !powerLost;
+	}
+
+	// Для функций avr-libc
+	void busyWait ()
+	{
+		uint64_t start = now;
+		while ( busy && !powerLost )
+			run (doneAt - now);
+		statistics.stall += now - start;
+	}
+	uint8_t read (uint16_t address)
+	{
+		busyWait ();
+		statistics.reads ++;
+		return cell (address);
+	}
+	void write (uint16_t address, uint8_t value)
+	{
+		busyWait ();
+		start (address, value);
+	}
+	void update (uint16_t address, uint8_t value)
+	{
+		busyWait ();
+		if ( cell (address) != value )
+			start (address, value);
+	}
+
+	// Образ eeprom для "перезапуска" в другом процессе
+	void save (uint8_t* image) const { memcpy (image, cells (), size ()); }
+	void load (const uint8_t* image) { memcpy (cells (), image, size ()); }
+
+	// Выполняет f в дочернем процессе - как новый запуск программы со своими объектами. Возвращает код выхода
+	template<typename F>
+	static int inChild (F f)
+	{
+		pid_t pid = fork ();
+		if ( pid == 0 )
+			_exit (f ());
+		int status;
+		waitpid (pid, &status, 0);
+		return WIFEXITED (status) ? WEXITSTATUS (status) : 255;
+	}
+
+private:
+	uint64_t now;
+	bool busy;
+	uint64_t doneAt;
+	uint16_t busyAddress;
+	uint8_t busyValue;
+	uint8_t masterArmed;			// Сколько ещё обращений действует EEMWE
+	uint64_t writeNumber;
+	uint64_t cutAt;
+	bool powerLost;
+	uint32_t seed;
+	Statistics statistics;
+	uint32_t* wear;
+
+	uint8_t lastControl;
+	uint8_t lastData;
+	uint8_t* lastAddress;
+
+	uint8_t& control () { return *(uint8_t*) &registers().eepromControl; }
+	uint8_t& data () { return *(uint8_t*) &registers().eepromData; }
+	uint8_t*& addressRegister () { return *(uint8_t**) &registers().eepromAddress; }
+
+	uint8_t& cell (uint16_t address)
+	{
+		if ( address >= size () )
+		{
+			statistics.protocolErrors ++;
+			static uint8_t dummy;
+			return dummy;
+		}
+		return cells()[address];
+	}
+
+	void snapshot ()
+	{
+		lastControl = control ();
+		lastData = data ();
+		lastAddress = addressRegister ();
+	}
+
+	void start (uint16_t address, uint8_t value)
+	{
+		if ( powerLost )
+			return;
+		statistics.writes ++;
+		if ( cell (address) == value )
+			statistics.writesEqual ++;
+		if ( address < size () )
+			wear[address] ++;
+		if ( ++writeNumber == cutAt )
+		{
+			seed = seed * 1103515245 + 12345;
+			cell (address) = seed >> 16;
+			powerLost = true;
+			return;
+		}
+		busy = true;
+		busyAddress = address;
+		busyValue = value;
+		doneAt = now + writeTime;
+		control () |= writeEnable;
+		snapshot ();
+	}
+
+	void complete ()
+	{
+		busy = false;
+		cell (busyAddress) = busyValue;
+		control () &= ~writeEnable;
+		snapshot ();
+	}
+
+	void access (const volatile void*)
+	{
+		uint8_t c = control ();
+		if ( busy && (addressRegister () != lastAddress || data () != lastData) )
+			statistics.protocolErrors ++;
+
+		if ( c & readEnable )
+		{
+			if ( busy )
+				statistics.protocolErrors ++;
+			else
+			{
+				statistics.reads ++;
+				data () = cell (address (addressRegister ()));
+			}
+			c &= ~readEnable;
+		}
+
+		bool masterWasSet = masterArmed != 0;
+		if ( (c & masterWriteEnable) && !(lastControl & masterWriteEnable) )
+			masterArmed = 2;
+
+		if ( busy )
+			c |= writeEnable;				// Во время записи EEWE не сбрасывается программой
+		else if ( (c & writeEnable) && !(lastControl & writeEnable) )
+		{
+			c &= ~writeEnable;
+			if ( masterWasSet )
+			{
+				control () = c & ~masterWriteEnable;
+				masterArmed = 0;
+				start (address (addressRegister ()), data ());
+				return;
+			}
+		}
+		else
+			c &= ~writeEnable;
+
+		if ( masterArmed && --masterArmed == 0 )
+			c &= ~masterWriteEnable;
+		control () = c;
+		snapshot ();
+	}
+};
+
+EepromModel eepromModel;
+
+#endif /* HOST_EEPROM_MODEL_H_ */
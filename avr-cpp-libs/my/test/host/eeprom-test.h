@@ -0,0 +1,31 @@
+/*
+ * eeprom-test.h
+ *
+ * Общее для тестов eeprom на модели (eeprom-model.h)
+ * **************************************************
+ *
+ *  settle ()	- основной цикл, пока модель не допишет всё, включая запросы, поставленные командами диспетчера.
+ *				  Каждый запрос ставит в диспетчер свою команду, поэтому диспетчер выбирается целиком
+ *				  (256 - его ёмкость). false - пропало питание.
+ */
+
+#ifndef HOST_EEPROM_TEST_H_
+#define HOST_EEPROM_TEST_H_
+
+#include <cpp/eeprom.h>
+#include "test-check.h"
+
+static inline bool settle ()
+{
+	do
+	{
+		if ( !eepromModel.finish () )
+			return false;
+		for (uint16_t i = 0; i < 256; ++i)
+			dispatcher.invoke ();
+	}
+	while ( eepromModel.isBusy () || EepromStaticPrivate::active );
+	return true;
+}
+
+#endif /* HOST_EEPROM_TEST_H_ */
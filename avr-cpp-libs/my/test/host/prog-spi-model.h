@@ -0,0 +1,313 @@
+/*
+ * prog-spi-model.h
+ *
+ * Модель программируемой по SPI микросхемы AVR для тестов на компьютере
+ * *********************************************************************
+ *
+ *  ~~~ Задача: ~~~
+ *  Выполнять ProgSpiSimple (prog-spi.h) и построенный на нём код без изменений, как на микроконтроллере:
+ *  через регистры spiStatusControl, spiData (SPCR, SPSR, SPDR), и проверять, что микросхема получила
+ *  правильные инструкции в правильное время: страницы записаны целиком и один раз, адреса больше 128 кБ
+ *  доходят через Load Extended Address, во время записи микросхему опрашивают только Poll RDY/BSY.
+ *
+ *  ~~~ Решение: ~~~
+ *  1. Обращения к регистрам перехватывает RegisterTrap (register-trap.h). Запись в spiData - передача байта:
+ *     она заканчивается сразу, в spiData кладётся ответ микросхемы и устанавливается transferComplete (SPIF).
+ *     Время передачи (8 тактов SCK при делителе из spiStatusControl) добавляется к модельному времени.
+ *  2. Байты складываются в инструкции по 4 (Serial Programming Instruction Set из datasheet ATmega).
+ *     Запись в spiStatusControl (новый делитель) начинает инструкцию заново.
+ *     Ответ на байт 2 - байт 1, на байт 3 - байт 2 (эхо), на байт 4 - данные чтения или байт 3.
+ *  3. До Programming Enable (0xAC 0x53) инструкции не выполняются.
+ *  4. Запись страницы flash (0x4C), страницы eeprom (0xC2), байта eeprom (0xC0), fuse и отчистка
+ *     занимают ...Time модельного времени. Poll RDY/BSY (0xF0) отвечает 1, пока запись идёт.
+ *     Любая другая инструкция во время записи считается в busyInstructions - на микросхеме она потерялась бы.
+ *  5. Запись страницы flash только сбрасывает биты (ячейка &= буфер), как без отчистки.
+ *     Буфер страницы flash после записи снова 0xFF. Страница eeprom пишет только загруженные байты.
+ *  6. Модельное время - время передачи байт плюс задержки _delay_... (hostDelayTime из host/util/delay.h), нсек.
+ *  7. По умолчанию - ATmega2560: flash 256 кБ (страница 256 байт), eeprom 4 кБ (страница 8 байт).
+ *
+ *  ~~~ Ограничения: ~~~
+ *  1. Вывод RESET не моделируется: микросхема в режиме программирования с первой Programming Enable.
+ *  2. Передача байта не ждёт SCK: SPIF устанавливается сразу после записи spiData.
+ */
+
+#ifndef HOST_PROG_SPI_MODEL_H_
+#define HOST_PROG_SPI_MODEL_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#include <cpp/io.h>
+#include <util/delay.h>
+#include "register-trap.h"
+
+class ProgSpiModel : public RegisterTrap
+{
+public:
+	struct Statistics
+	{
+		uint64_t instructions;
+		uint64_t flashPagesWritten;
+		uint64_t eepromPagesWritten;
+		uint64_t eepromBytesWritten;	// Байт, записанных страницами и по одному
+		uint64_t polls;					// Инструкций Poll RDY/BSY
+		uint64_t busyInstructions;		// Других инструкций во время записи
+		uint64_t protocolErrors;		// Неизвестная инструкция, адрес за пределами памяти, передача без SPI
+	};
+
+	// Время записи, мксек. На настоящей микросхеме обычно в несколько раз меньше T_WD_... из prog-spi.h
+	uint32_t flashWriteTime;
+	uint32_t eepromWriteTime;
+	uint32_t eraseTime;
+	uint32_t fuseWriteTime;
+
+	ProgSpiModel (uint32_t signature_ = 0x1E9801, uint32_t flashSize_ = 256 * 1024UL, uint16_t flashPageSize_ = 256,
+				  uint16_t eepromSize_ = 4096, uint8_t eepromPageSize_ = 8)
+		: flashWriteTime (2500), eepromWriteTime (3600), eraseTime (9000), fuseWriteTime (2500),
+		  signature (signature_), flashSize (flashSize_), flashPageSize (flashPageSize_),
+		  eepromSize (eepromSize_), eepromPageSize (eepromPageSize_),
+		  flashMemory (new uint8_t[flashSize_]), eepromMemory (new uint8_t[eepromSize_]),
+		  flashBuffer (new uint8_t[flashPageSize_]), eepromBuffer (new uint8_t[eepromPageSize_]),
+		  eepromLoaded (new bool[eepromPageSize_]), progMode (false), byteNumber (0), extended (0),
+		  spiTime (0), busyUntil (0), statistics ()
+	{
+		fuses[0] = 0x62;	fuses[1] = 0xD9;	fuses[2] = 0xFF;	fuses[3] = 0xFF;	// low, high, ext, lock
+		erase ();
+	}
+
+	uint8_t* flash () const { sync (); return flashMemory; }
+	uint8_t* eeprom () const { sync (); return eepromMemory; }
+	uint32_t getFlashSize () const { return flashSize; }
+	uint16_t getEepromSize () const { return eepromSize; }
+	uint8_t fuse (uint8_t n) const { sync (); return fuses[n]; }
+
+	// Модельное время, нсек
+	uint64_t time () const { sync (); return spiTime + hostDelayTime; }
+	bool isBusy () const { return time () < busyUntil; }
+	bool isInProgMode () const { sync (); return progMode; }
+	const Statistics& getStatistics () const { sync (); return statistics; }
+	void resetStatistics () { statistics = Statistics (); }
+
+	void erase ()
+	{
+		memset (flashMemory, 0xFF, flashSize);
+		memset (eepromMemory, 0xFF, eepromSize);
+		memset (flashBuffer, 0xFF, flashPageSize);
+		memset (eepromLoaded, 0, eepromPageSize);
+	}
+
+private:
+	enum
+	{
+		spiEnable			= 1 << 6,
+		spiMaster			= 1 << 4,
+		spiDoubleSpeed		= 1 << 8,
+		spiTransferComplete	= 1 << 15
+	};
+
+	uint32_t signature;
+	uint32_t flashSize;
+	uint16_t flashPageSize;
+	uint16_t eepromSize;
+	uint8_t eepromPageSize;
+	uint8_t* flashMemory;
+	uint8_t* eepromMemory;
+	uint8_t* flashBuffer;
+	uint8_t* eepromBuffer;
+	bool* eepromLoaded;
+	uint8_t fuses[4];
+
+	bool progMode;
+	uint8_t byteNumber;				// Номер байта в инструкции
+	uint8_t in[4];
+	uint8_t out;					// Ответ на последний байт инструкции
+	uint8_t extended;				// Load Extended Address
+	uint64_t spiTime;
+	uint64_t busyUntil;
+	Statistics statistics;
+
+	typedef uint16_t __attribute__ ((__may_alias__)) Word;
+	Word& control () { return *(Word*) &registers().spiStatusControl; }
+	uint8_t& data () { return *(uint8_t*) &registers().spiData; }
+
+	void access (const volatile void* written)
+	{
+		if ( written == programAddress (&Register::spiData) )
+			transfer (data ());
+		else if ( written == programAddress (&Register::spiStatusControl) )
+			byteNumber = 0;
+	}
+
+	void transfer (uint8_t b)
+	{
+		uint16_t c = control ();
+		if ( (c & (spiEnable | spiMaster)) != (spiEnable | spiMaster) )
+		{
+			statistics.protocolErrors ++;
+			return;
+		}
+		static const uint8_t prescale[4] = { 4, 16, 64, 128 };
+		uint8_t divider = prescale[c & 0b11] >> ((c & spiDoubleSpeed) ? 1 : 0);
+		spiTime += 8 * divider * 1000000000ULL / F_CPU;
+
+		in[byteNumber] = b;
+		uint8_t answer = 0;
+		switch (byteNumber)
+		{
+		case 0:
+			break;
+		case 1:
+			answer = in[0];
+			if ( in[0] == 0xAC && in[1] == 0x53 )
+				progMode = true;
+			break;
+		case 2:
+			answer = in[1];
+			if ( progMode )
+				out = read ();
+			break;
+		case 3:
+			answer = progMode ? out : 0;
+			if ( progMode )
+				write ();
+			break;
+		}
+		byteNumber = (byteNumber + 1) & 3;
+		data () = answer;
+		control () = c | spiTransferComplete;
+	}
+
+	void startWrite (uint32_t duration) { busyUntil = time () + uint64_t(duration) * 1000; }
+
+	uint32_t flashAddress () const { return (uint32_t(extended) << 17) | (uint32_t(in[1]) << 9) | (uint32_t(in[2]) << 1); }
+	uint16_t eepromAddress () const { return (in[1] << 8) | in[2]; }
+
+	// Инструкция по первым трём байтам: ответ для четвёртого
+	uint8_t read ()
+	{
+		statistics.instructions ++;
+		if ( in[0] == 0xF0 )
+		{
+			statistics.polls ++;
+			return isBusy () ? 1 : 0;
+		}
+		if ( isBusy () )
+			statistics.busyInstructions ++;
+
+		switch (in[0])
+		{
+		case 0x20:
+		case 0x28:
+		{
+			uint32_t a = flashAddress () | (in[0] == 0x28);
+			if ( a < flashSize )
+				return flashMemory[a];
+			statistics.protocolErrors ++;
+			return 0xFF;
+		}
+		case 0xA0:
+			if ( eepromAddress () < eepromSize )
+				return eepromMemory[eepromAddress ()];
+			statistics.protocolErrors ++;
+			return 0xFF;
+		case 0x30:
+			return (in[2] & 3) < 3 ? signature >> (8 * (2 - (in[2] & 3))) : 0;
+		case 0x50:
+			return in[1] == 0x08 ? fuses[2] : fuses[0];
+		case 0x58:
+			return in[1] == 0x08 ? fuses[1] : fuses[3];
+		}
+		return in[2];
+	}
+
+	// Инструкция целиком
+	void write ()
+	{
+		uint8_t b = in[3];
+		switch (in[0])
+		{
+		case 0x40:
+		case 0x48:
+			flashBuffer[(flashAddress () | (in[0] == 0x48)) & (flashPageSize - 1)] = b;
+			break;
+		case 0x4C:
+		{
+			uint32_t page = flashAddress () & ~uint32_t(flashPageSize - 1);
+			if ( page >= flashSize )
+			{
+				statistics.protocolErrors ++;
+				break;
+			}
+			for (uint16_t i = 0; i < flashPageSize; ++i)
+				flashMemory[page + i] &= flashBuffer[i];
+			memset (flashBuffer, 0xFF, flashPageSize);
+			statistics.flashPagesWritten ++;
+			startWrite (flashWriteTime);
+			break;
+		}
+		case 0x4D:
+			extended = in[2];
+			break;
+		case 0xC0:
+			if ( eepromAddress () < eepromSize )
+			{
+				eepromMemory[eepromAddress ()] = b;
+				statistics.eepromBytesWritten ++;
+				startWrite (eepromWriteTime);
+			}
+			else
+				statistics.protocolErrors ++;
+			break;
+		case 0xC1:
+			eepromBuffer[in[2] & (eepromPageSize - 1)] = b;
+			eepromLoaded[in[2] & (eepromPageSize - 1)] = true;
+			break;
+		case 0xC2:
+		{
+			uint16_t page = eepromAddress () & ~(eepromPageSize - 1);
+			if ( page >= eepromSize )
+			{
+				statistics.protocolErrors ++;
+				break;
+			}
+			for (uint8_t i = 0; i < eepromPageSize; ++i)
+				if ( eepromLoaded[i] )
+				{
+					eepromMemory[page + i] = eepromBuffer[i];
+					eepromLoaded[i] = false;
+					statistics.eepromBytesWritten ++;
+				}
+			statistics.eepromPagesWritten ++;
+			startWrite (eepromWriteTime);
+			break;
+		}
+		case 0xAC:
+			switch (in[1])
+			{
+			case 0x53:											break;
+			case 0x80:	erase ();		startWrite (eraseTime);	break;
+			case 0xA0:	fuses[0] = b;	startWrite (fuseWriteTime);	break;
+			case 0xA8:	fuses[1] = b;	startWrite (fuseWriteTime);	break;
+			case 0xA4:	fuses[2] = b;	startWrite (fuseWriteTime);	break;
+			case 0xE0:	fuses[3] = b;	startWrite (fuseWriteTime);	break;
+			default:	statistics.protocolErrors ++;				break;
+			}
+			break;
+		case 0x20:
+		case 0x28:
+		case 0xA0:
+		case 0x30:
+		case 0x50:
+		case 0x58:
+		case 0xF0:
+			break;
+		default:
+			statistics.protocolErrors ++;
+			break;
+		}
+	}
+};
+
+ProgSpiModel progSpiModel;
+
+#endif /* HOST_PROG_SPI_MODEL_H_ */
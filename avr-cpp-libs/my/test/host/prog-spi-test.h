@@ -0,0 +1,50 @@
+/*
+ * prog-spi-test.h
+ *
+ * Общее для тестов ProgSpiSimple на модели микросхемы (prog-spi-model.h)
+ * **********************************************************************
+ *
+ *  Neighbour		- ProgSpiSimple на SPI порта B, RESET - пин 4 порта E (как в примерах prog-spi.h)
+ *  connect ()		- перевод в режим программирования, проверка сигнатуры и геометрии памяти модели
+ *  elapsed (start)	- модельное время с момента start, мксек
+ *  fill ()			- псевдослучайные данные
+ *
+ *  PROGSPI_POLL_READY определяется в тесте до включения этого файла.
+ */
+
+#ifndef HOST_PROG_SPI_TEST_H_
+#define HOST_PROG_SPI_TEST_H_
+
+#include "prog-spi-model.h"
+#include <cpp/prog-spi.h>
+#include "test-check.h"
+
+using namespace ProgSpi;
+
+typedef ProgSpiSimple<&Register::spiStatusControl, &Register::spiData, &Register::portB, 0, 1, 2, 3, &Register::portE, 4> Neighbour;
+
+static inline bool connect (Neighbour& neighbour)
+{
+	bool ok = neighbour.rebootInProg ();
+	check (ok, "rebootInProg failed");
+	check (neighbour.readSignature () == 0x1E9801, "wrong signature");
+	check (neighbour.isKnownDevice () && neighbour.getFlashSize () == progSpiModel.getFlashSize ()
+		   && neighbour.getFlashPageSize () == 256 && neighbour.getEepromPageSize () == 8, "wrong device geometry");
+	return ok;
+}
+
+static inline double elapsed (uint64_t start)
+{
+	return (progSpiModel.time () - start) / 1000.0;
+}
+
+static inline void fill (uint8_t* data, uint32_t length, uint32_t seed)
+{
+	for (uint32_t i = 0; i < length; ++i)
+	{
+		seed = seed * 1103515245 + 12345;
+		data[i] = seed >> 16;
+	}
+}
+
+#endif /* HOST_PROG_SPI_TEST_H_ */
@@ -0,0 +1,132 @@
+/*
+ * register-trap.h
+ *
+ * Перехват обращений к регистрам для моделей устройств в тестах на компьютере
+ * ***************************************************************************
+ *
+ *  ~~~ Задача: ~~~
+ *  Модель устройства (eeprom-model.h, prog-spi-model.h) должна видеть каждое обращение кода библиотеки
+ *  к регистрам в том порядке, в каком его делает код, и отвечать на него, как устройство на AVR.
+ *
+ *  ~~~ Решение: ~~~
+ *  1. Страница регистров (hostRegisterSpace) отображается дважды: для программы - без доступа, на своём месте,
+ *     для модели (view) - обычно.
+ *     Каждое обращение программы к регистру вызывает SIGSEGV. Обработчик запоминает адрес записи (если это запись),
+ *     открывает страницу и выполняет одну команду по шагам (флаг TF), после неё SIGTRAP снова закрывает страницу
+ *     и вызывает access () модели. В written - адрес регистра, в который писала команда, или 0 для чтения.
+ *  2. Запись SREG через reg.status разрешает или запрещает SIGALRM (прерывания), как hostSreg.
+ *  3. Перехват один на программу: последняя созданная модель.
+ *  4. Модель меняется из обработчика сигнала, о котором компилятор не знает. Функции, которыми тест читает
+ *     её состояние, начинаются с sync (), иначе прочитанное до обращения к регистрам может не перечитаться после.
+ *
+ *  ~~~ Ограничения: ~~~
+ *  1. Только x86-64 Linux.
+ */
+
+#ifndef HOST_REGISTER_TRAP_H_
+#define HOST_REGISTER_TRAP_H_
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <ucontext.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include <cpp/io.h>
+
+#if !defined (__x86_64__) || !defined (__linux__)
+#  error "register-trap.h: x86-64 Linux only (single-step through EFLAGS.TF)"
+#endif
+
+class RegisterTrap
+{
+public:
+	RegisterTrap ()
+	{
+		int fd = memfd_create ("avr-registers", 0);
+		if ( fd < 0 || ftruncate (fd, pageSize) != 0 )
+			abort ();
+		view = (uint8_t*) mmap (0, pageSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		if ( view == MAP_FAILED )
+			abort ();
+		memcpy (view, hostRegisterSpace, pageSize);
+		trapped = (uint8_t*) mmap (hostRegisterSpace, pageSize, PROT_NONE, MAP_SHARED | MAP_FIXED, fd, 0);
+		close (fd);
+		if ( trapped != hostRegisterSpace )
+			abort ();
+		static_assert (sizeof (Register) <= pageSize, "Register does not fit the model page");
+		instance = this;
+
+		struct sigaction a;
+		memset (&a, 0, sizeof (a));
+		a.sa_flags = SA_SIGINFO;
+		a.sa_sigaction = &RegisterTrap::segv;
+		sigaction (SIGSEGV, &a, 0);
+		a.sa_sigaction = &RegisterTrap::trap;
+		sigaction (SIGTRAP, &a, 0);
+	}
+
+protected:
+	enum { pageSize = 4096 };
+
+	// После каждой команды программы, обратившейся к регистрам
+	virtual void access (const volatile void* written) = 0;
+
+	static void sync () { __asm__ __volatile__ ("" ::: "memory"); }
+
+	Register& registers () { return *(Register*) view; }
+	uint8_t& status () { return *(uint8_t*) &registers().status; }
+
+	// Адрес регистра, каким его видит программа (reg.*)
+	template <typename T>
+	static const volatile void* programAddress (T Register::* r) { return &(reg.*r); }
+
+private:
+	uint8_t* view;
+	uint8_t* trapped;
+	uint8_t lastStatus;
+	const volatile void* written;
+
+	static RegisterTrap* instance;
+
+	static bool isTrapped (void* address)
+	{
+		return instance && (uint8_t*)address >= instance->trapped && (uint8_t*)address < instance->trapped + pageSize;
+	}
+
+	static void segv (int, siginfo_t* info, void* context)
+	{
+		if ( !isTrapped (info->si_addr) )
+		{
+			signal (SIGSEGV, SIG_DFL);
+			return;
+		}
+		ucontext_t* u = (ucontext_t*) context;
+		instance->written = (u->uc_mcontext.gregs[REG_ERR] & 2) ? info->si_addr : 0;	// Бит W кода ошибки страницы
+		instance->status () = sigismember (&u->uc_sigmask, SIGALRM) ? 0 : 0x80;	// SREG (reg.status)
+		instance->lastStatus = instance->status ();
+		mprotect (instance->trapped, pageSize, PROT_READ | PROT_WRITE);
+		u->uc_mcontext.gregs[REG_EFL] |= 0x100;
+	}
+
+	static void trap (int, siginfo_t*, void* context)
+	{
+		ucontext_t* u = (ucontext_t*) context;
+		u->uc_mcontext.gregs[REG_EFL] &= ~0x100;
+		mprotect (instance->trapped, pageSize, PROT_NONE);
+		if ( instance->status () != instance->lastStatus )		// Запись SREG через reg.status
+		{
+			if ( instance->status () & 0x80 )
+				sigdelset (&u->uc_sigmask, SIGALRM);
+			else
+				sigaddset (&u->uc_sigmask, SIGALRM);
+		}
+		instance->access (instance->written);
+	}
+};
+
+RegisterTrap* RegisterTrap::instance = 0;
+
+#endif /* HOST_REGISTER_TRAP_H_ */
@@ -0,0 +1,29 @@
+/*
+ * test-check.h
+ *
+ * Проверки тестов на компьютере
+ * *****************************
+ *
+ *  check (ok, what)	- при ok == false печатает "<тест>: FAILED: what" и запоминает провал
+ *  return testFailed;	- код выхода main: run.sh считает тест проваленным, если он не 0
+ *  Имя теста - имя исполняемого файла (run.sh собирает каждый тест в файл с именем исходника).
+ */
+
+#ifndef HOST_TEST_CHECK_H_
+#define HOST_TEST_CHECK_H_
+
+#include <errno.h>
+#include <stdio.h>
+
+static bool testFailed = false;
+
+static inline void check (bool ok, const char* what)
+{
+	if ( !ok )
+	{
+		printf ("%s: FAILED: %s\n", program_invocation_short_name, what);
+		testFailed = true;
+	}
+}
+
+#endif /* HOST_TEST_CHECK_H_ */
@@ -0,0 +1,22 @@
+/*
+ * util/delay.h для сборки тестов на компьютере: задержки не ждут, а только складываются в hostDelayTime (нсек).
+ * Модели устройств (prog-spi-model.h) добавляют его к своему модельному времени.
+ */
+
+#ifndef HOST_UTIL_DELAY_H_
+#define HOST_UTIL_DELAY_H_
+
+#include <stdint.h>
+
+#ifndef F_CPU
+#define F_CPU 16000000UL
+#endif
+
+volatile uint64_t hostDelayTime;	// volatile: модель читает его между обращениями к регистрам
+
+static inline void _delay_ms (double ms) { hostDelayTime += ms * 1000000; }
+static inline void _delay_us (double us) { hostDelayTime += us * 1000; }
+static inline void _delay_loop_1 (uint8_t n) { hostDelayTime += (n ? n : 256) * 3 * 1000000000ULL / F_CPU; }
+static inline void _delay_loop_2 (uint16_t n) { hostDelayTime += (n ? n : 65536) * 4 * 1000000000ULL / F_CPU; }
+
+#endif /* HOST_UTIL_DELAY_H_ */
@@ -0,0 +1,172 @@
+/*
+ * image-decoder-hex.cpp
+ *
+ * ImageDecoder (image-decoder.h) с прошивкой через ProgSpiSimple на модели микросхемы (host/prog-spi-model.h)
+ * ***********************************************************************************************************
+ *
+ *  1. Intel HEX в несколько страниц, как от avr-objcopy: записи по 16 и 32 байта, запись 02 (сегмент)
+ *     с данными через границу 128 кБ, запись 04 с данными до конца flash 256 кБ, запись 05, неполная последняя
+ *     запись. Страницы декодера уходят в writePage, в flash модели должен оказаться ровно образ,
+ *     каждая страница - один раз.
+ *  2. Испорченная контрольная сумма записи: put () возвращает error на этой записи, страница с её данными
+ *     не отдаётся, отданные до неё страницы верны.
+ *  3. Двоичный образ кусками разной длины с base через границу 128 кБ, последняя страница - в finish ().
+ *  4. Время прошивки образа в модельном времени.
+ *
+ *  Сборка и запуск - run.sh
+ */
+
+#define PROGSPI_POLL_READY
+#include <prog-spi-test.h>
+#include <cpp/image-decoder.h>
+
+static Neighbour neighbour;
+typedef ImageDecoder<256> Decoder;
+
+enum { flashSize = 256 * 1024UL };
+static uint8_t image[flashSize];				// Ожидаемое содержимое flash
+static char hex[1024 * 1024];
+static uint32_t hexLength;
+
+static uint32_t pages[1024];					// Адреса отданных страниц
+static uint16_t pageCount;
+
+static void page (uint32_t address, const uint8_t* data, uint16_t length)
+{
+	if ( pageCount < sizeof (pages) / sizeof (pages[0]) )
+		pages[pageCount ++] = address;
+	neighbour.writePage<flash> (address, data, length);
+}
+
+static void record (uint8_t type, uint16_t address, const uint8_t* data, uint8_t length)
+{
+	uint8_t sum = length + (address >> 8) + address + type;
+	hexLength += sprintf (hex + hexLength, ":%02X%04X%02X", length, address, type);
+	for (uint8_t i = 0; i < length; ++i)
+	{
+		hexLength += sprintf (hex + hexLength, "%02X", data[i]);
+		sum += data[i];
+	}
+	hexLength += sprintf (hex + hexLength, "%02X\r\n", uint8_t (-sum));
+}
+
+// Данные [address, address + length) записями по recordSize байт, адрес записи - от base
+static void data (uint32_t base, uint32_t address, uint32_t length, uint8_t recordSize, uint32_t seed)
+{
+	fill (image + address, length, seed);
+	for (uint32_t a = address; a < address + length; a += recordSize)
+	{
+		uint8_t n = address + length - a < recordSize ? address + length - a : recordSize;
+		record (0, a - base, image + a, n);
+	}
+}
+
+static void makeHex ()
+{
+	memset (image, 0xFF, flashSize);
+	hexLength = 0;
+	data (0, 0, 0x2800, 16, 1);										// Младшие 10 кБ
+	uint8_t segment[2] = { 0x1F, 0xF0 };								// 02: база 0x1FF00
+	record (2, 0, segment, 2);
+	data (0x1FF00, 0x1FF00, 0x200, 32, 2);							// Через границу 128 кБ (слово 0x10000)
+	uint8_t upper[2] = { 0x00, 0x03 };								// 04: база 0x30000
+	record (4, 0, upper, 2);
+	data (0x30000, 0x3FE00, 0x1F9, 16, 3);							// До конца flash, последняя запись 9 байт
+	uint8_t start[4] = { 0, 0, 0, 0 };
+	record (5, 0, start, 4);
+	record (1, 0, 0, 0);
+}
+
+static bool expectFlash (uint32_t from, uint32_t to)
+{
+	return memcmp (progSpiModel.flash () + from, image + from, to - from) == 0;
+}
+
+static void whole ()
+{
+	makeHex ();
+	neighbour.erase ();
+	progSpiModel.resetStatistics ();
+	pageCount = 0;
+	Decoder decoder (Decoder::PageHandler::from_function<&page> ());
+
+	uint64_t begin = progSpiModel.time ();
+	Decoder::Status s = Decoder::ok;
+	for (uint32_t i = 0; i < hexLength && s == Decoder::ok; i += 61)				// Кусками, как из кадров USART/CAN
+		s = decoder.put ((const uint8_t*) hex + i, hexLength - i < 61 ? hexLength - i : 61);
+	double time = elapsed (begin) / 1000000;
+
+	uint16_t expected = 0x2800 / 256 + 0x200 / 256 + 2;
+	check (s == Decoder::end, "hex image did not end with record 01");
+	check (decoder.getPageCount () == expected && pageCount == expected, "wrong number of pages from hex image");
+	check (progSpiModel.getStatistics ().flashPagesWritten == expected, "hex page written more than once");
+	check (expectFlash (0, flashSize), "flash differs from hex image");
+	bool ascending = true;
+	for (uint16_t i = 1; i < pageCount; ++i)
+		ascending = ascending && pages[i] > pages[i - 1];
+	check (ascending, "hex pages not delivered once each in address order");
+	printf ("  hex: %u chars, %u pages (02 across 128 kB, 04 up to 256 kB), flashed in %.3f s\n",
+			(unsigned)hexLength, (unsigned)pageCount, time);
+}
+
+static void corrupted ()
+{
+	makeHex ();
+	// Запись с адресом 0x1230 (страница 0x1200): последний символ контрольной суммы +1
+	char* line = strstr (hex, ":10123000");
+	char* sum = strchr (line, '\r') - 1;
+	*sum = *sum == '9' ? 'A' : (*sum == 'F' ? '0' : *sum + 1);
+
+	neighbour.erase ();
+	pageCount = 0;
+	Decoder decoder (Decoder::PageHandler::from_function<&page> ());
+	uint32_t i = 0;
+	Decoder::Status s = Decoder::ok;
+	while ( i < hexLength && (s = decoder.put (hex[i])) == Decoder::ok )
+		i ++;
+
+	check (s == Decoder::error && hex + i == sum, "bad checksum not reported on its record");
+	check (decoder.put ((const uint8_t*) hex + i + 1, 16) == Decoder::error && decoder.finish () == Decoder::error,
+		   "decoder continued after error");
+	check (pageCount == 0x12 && pages[pageCount - 1] == 0x1100, "page with the bad record was delivered");
+	check (expectFlash (0, 0x1200), "pages before the bad record differ");
+	bool untouched = true;
+	for (uint32_t a = 0x1200; a < flashSize; ++a)
+		untouched = untouched && progSpiModel.flash ()[a] == 0xFF;
+	check (untouched, "flash written after the bad record");
+	printf ("  bad checksum at 0x1230: error on its record, %u pages before it delivered\n", (unsigned)pageCount);
+}
+
+static void binary ()
+{
+	memset (image, 0xFF, flashSize);
+	fill (image + 0x1FE80, 0x300, 4);
+	neighbour.erase ();
+	pageCount = 0;
+	Decoder decoder (Decoder::PageHandler::from_function<&page> (), Decoder::binary, 0x1FE80);
+	uint32_t a = 0x1FE80;
+	for (uint16_t n = 1; a < 0x20180; n = n * 3 % 97 + 1)
+	{
+		if ( n > 0x20180 - a )
+			n = 0x20180 - a;
+		check (decoder.put (image + a, n) == Decoder::ok, "binary put failed");
+		a += n;
+	}
+	check (pageCount == 3, "binary pages delivered before finish");
+	check (decoder.finish () == Decoder::end && pageCount == 4, "binary finish did not deliver the last page");
+	check (expectFlash (0, flashSize), "flash differs from binary image");
+	printf ("  binary: 0x300 bytes at 0x1FE80 in odd chunks, %u pages\n", (unsigned)pageCount);
+}
+
+int main ()
+{
+	printf ("image-decoder-hex:\n");
+	if ( !connect (neighbour) )
+		return testFailed;
+	whole ();
+	corrupted ();
+	binary ();
+	check (progSpiModel.getStatistics ().busyInstructions == 0 && progSpiModel.getStatistics ().protocolErrors == 0,
+		   "protocol error while flashing");
+	return testFailed;
+}
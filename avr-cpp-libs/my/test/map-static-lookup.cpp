@@ -0,0 +1,141 @@
+/*
+ * map-static-lookup.cpp
+ *
+ * Таблицы MapStatic (map-static.h): результат поиска, размер во flash и число чтений flash
+ * ***************************************************************************************
+ *
+ *  Для каждого набора ключей каждая таблица (ReIndexWindow, ReIndex256, ReIndexPaged, ReIndexSparse,
+ *  выбор ReIndexAuto) опрашивается по всем ключам диапазона. Номер элемента должен быть позицией ключа
+ *  в списке (с 1), для отсутствующих ключей - 0 (корзина). ReIndex256 получает список пар (ключ, номер)
+ *  от Numbered, который нумерует с конца списка.
+ *  Печатается размер таблицы во flash (flashSize) и число чтений pgm_read на поиск - оценка времени:
+ *  на AVR каждое чтение - lpm, остальная работа поиска от набора ключей почти не зависит.
+ *  Через MapStatic256, MapStaticPaged и MapStaticAuto проверяется, что ключ даёт свой элемент,
+ *  а неизвестный ключ - корзину.
+ *
+ *  Сборка и запуск - run.sh
+ */
+
+#include <cpp/map-static.h>
+#include <test-check.h>
+
+extern uint32_t hostFlashReads;
+
+// Номер, который должна вернуть таблица: позиция в списке с 1 (reverse - с конца, как у Numbered)
+static uint8_t expected (const uint16_t* keys, uint8_t count, uint32_t k, bool reverse)
+{
+	for (uint8_t i = 0; i < count; ++i)
+		if ( keys[i] == k )
+			return reverse ? count - i : i + 1;
+	return 0;
+}
+
+template <class Table>
+static void verify (const char* set, const char* name, const uint16_t* keys, uint8_t count,
+					uint32_t range = 0x10000, bool reverse = false)
+{
+	Table table;
+	uint32_t errors = 0, hits = 0, hitReads = 0, missReads = 0, maxReads = 0;
+	for (uint32_t k = 0; k < range; ++k)
+	{
+		uint32_t before = hostFlashReads;
+		uint8_t got = table[k];
+		uint32_t reads = hostFlashReads - before;
+		uint8_t want = expected (keys, count, k, reverse);
+		if ( got != want )
+			errors ++;
+		if ( want )
+		{
+			hits ++;
+			hitReads += reads;
+		}
+		else
+			missReads += reads;
+		if ( reads > maxReads )
+			maxReads = reads;
+	}
+	printf ("  %-8s %-16s flash %6u B, reads per lookup: hit %.1f, miss %.1f, max %u\n",
+			set, name, (unsigned)Table::flashSize,
+			hits ? double(hitReads) / hits : 0.0, double(missReads) / (range - hits), (unsigned)maxReads);
+	if ( errors )
+		printf ("  %-8s %-16s %u wrong numbers\n", set, name, (unsigned)errors);
+	check (errors == 0, "table returns a wrong element number");
+	check (hits == count, "key range does not cover the key set");
+}
+
+// Элемент каждого ключа свой, неизвестные ключи - общая корзина
+template <class Map>
+static void verifyMap (const char* name, const uint16_t* keys, uint8_t count, uint16_t unknown)
+{
+	Map map;
+	map[unknown] = 0;
+	for (uint8_t i = 0; i < count; ++i)
+		map[keys[i]] = i + 1;
+	bool ok = map[unknown] == 0;
+	for (uint8_t i = 0; i < count; ++i)
+		ok = ok && map[keys[i]] == i + 1 && &map[keys[i]] != &map[unknown];
+	map[unknown + 1] = 0xAA;
+	ok = ok && map[unknown] == 0xAA;
+	check (ok, name);
+}
+
+// Плотные 8-битные ключи
+typedef INT_TYPELIST_4 (90, 5, 8, 3) Small;
+static const uint16_t small[] = { 90, 5, 8, 3 };
+
+// Идентификаторы CAN: группы рядом стоящих 11-битных ключей
+typedef INT_TYPELIST_12 (0x100, 0x101, 0x102, 0x103, 0x104, 0x105, 0x106, 0x107, 0x180, 0x181, 0x200, 0x7FF) Can;
+static const uint16_t can[] = { 0x100, 0x101, 0x102, 0x103, 0x104, 0x105, 0x106, 0x107, 0x180, 0x181, 0x200, 0x7FF };
+
+// Разбросанные 16-битные ключи
+typedef INT_TYPELIST_5 (0xFFF0, 0x1234, 7, 0x8000, 0xFFFF) Wide;
+static const uint16_t wide[] = { 0xFFF0, 0x1234, 7, 0x8000, 0xFFFF };
+
+// Много разбросанных 16-битных ключей
+typedef INT_TYPELIST_25 (0x0001, 0x0A11, 0x0A12, 0x13FF, 0x2000, 0x2001, 0x2F00, 0x3456, 0x4000, 0x4A4A,
+						 0x5555, 0x6001, 0x6002, 0x6003, 0x7000, 0x8888, 0x9ABC, 0xA000, 0xB00B, 0xC3C3,
+						 0xD000, 0xE1E1, 0xF000, 0xFF00, 0xFFFE) Many;
+static const uint16_t many[] = { 0x0001, 0x0A11, 0x0A12, 0x13FF, 0x2000, 0x2001, 0x2F00, 0x3456, 0x4000, 0x4A4A,
+								 0x5555, 0x6001, 0x6002, 0x6003, 0x7000, 0x8888, 0x9ABC, 0xA000, 0xB00B, 0xC3C3,
+								 0xD000, 0xE1E1, 0xF000, 0xFF00, 0xFFFE };
+
+int main ()
+{
+	printf ("map-static-lookup:\n");
+
+	verify< ReIndexWindow<Small> >					("small", "window", small, 4);
+	verify< ReIndex256< Numbered<Small>::Result > >	("small", "256", small, 4, 256, true);
+	verify< ReIndexPaged<Small> >					("small", "paged", small, 4);
+	verify< ReIndexSparse<Small> >					("small", "sparse", small, 4);
+	verify< ReIndexAuto<Small, 8>::Result >			("small", "auto", small, 4);
+	verify< ReIndexAuto<Small, 1>::Result >			("small", "auto 1 step", small, 4);
+
+	verify< ReIndexWindow<Can> >					("can", "window", can, 12);
+	verify< ReIndexPaged<Can> >						("can", "paged", can, 12);
+	verify< ReIndexPaged<Can, 4> >					("can", "paged 4 bit", can, 12);
+	verify< ReIndexSparse<Can> >					("can", "sparse", can, 12);
+	verify< ReIndexAuto<Can, 8>::Result >			("can", "auto", can, 12);
+
+	verify< ReIndexPaged<Wide> >					("wide", "paged", wide, 5);
+	verify< ReIndexPaged<Wide, 4> >					("wide", "paged 4 bit", wide, 5);
+	verify< ReIndexSparse<Wide> >					("wide", "sparse", wide, 5);
+	verify< ReIndexAuto<Wide, 8>::Result >			("wide", "auto", wide, 5);
+	verify< ReIndexAuto<Wide, 2>::Result >			("wide", "auto 2 steps", wide, 5);
+
+	verify< ReIndexPaged<Many> >					("many", "paged", many, 25);
+	verify< ReIndexSparse<Many> >					("many", "sparse", many, 25);
+	verify< ReIndexAuto<Many, 8>::Result >			("many", "auto", many, 25);
+
+	// Каталог 8/8 для 16-битных ключей: 256 байт каталога и по 256 на занятую страницу
+	check (ReIndexPaged<Wide>::flashSize == 256 + (4 + 1) * 256, "wide: default page split is not 8/8");
+	check (int (ReIndexPaged<Wide>::flashSize) < int (ReIndexPaged<Wide, 4>::flashSize), "wide: default split is bigger than 4 bit pages");
+	check (int (ReIndexAuto<Wide, 8>::Result::flashSize) == int (ReIndexSparse<Wide>::flashSize), "wide: auto did not choose sparse");
+	check (int (ReIndexAuto<Wide, 2>::Result::flashSize) == int (ReIndexPaged<Wide>::flashSize), "wide: auto did not choose paged");
+	check (int (ReIndexAuto<Small, 1>::Result::flashSize) == int (ReIndexPaged<Small>::flashSize), "small: auto did not choose paged");
+
+	verifyMap< MapStatic256<uint8_t, Small> >		("MapStatic256: wrong element", small, 4, 200);
+	verifyMap< MapStaticPaged<uint8_t, Wide> >		("MapStaticPaged: wrong element", wide, 5, 0x4000);
+	verifyMap< MapStaticAuto<uint8_t, Many> >		("MapStaticAuto: wrong element", many, 25, 0x1000);
+
+	return testFailed;
+}
@@ -0,0 +1,117 @@
+/*
+ * prog-spi-block.cpp
+ *
+ * Блочные writePage и readBlock ProgSpiSimple на модели микросхемы (host/prog-spi-model.h)
+ * ****************************************************************************************
+ *
+ *  1. writePage с началом и концом посреди страниц flash и eeprom: каждая затронутая страница микросхемы
+ *     записывается один раз, в памяти - ровно данные блока, соседние байты не тронуты.
+ *  2. readBlock через границу 64К слов flash (байт 0x1FFFF - 0x20000): старший байт адреса слова
+ *     уходит через Load Extended Address, с чётного и нечётного начала.
+ *  3. Вся flash (256 кБ) блоками по 1 кБ: запись, чтение, сравнение, скорость в модельном времени.
+ *
+ *  Сборка и запуск - run.sh
+ */
+
+#define PROGSPI_POLL_READY
+#include <prog-spi-test.h>
+
+static Neighbour neighbour;
+
+enum { flashSize = 256 * 1024UL };
+static uint8_t image[flashSize];
+static uint8_t back[flashSize];
+
+// Блок [address, address + length) записан, байты вокруг остались 0xFF
+static bool written (const uint8_t* memory, uint32_t address, const uint8_t* data, uint16_t length)
+{
+	return memcmp (memory + address, data, length) == 0
+		&& (address == 0 || memory[address - 1] == 0xFF) && memory[address + length] == 0xFF;
+}
+
+static void split ()
+{
+	// flash: 128 байт в конце страницы 0x1F00, страница 0x2000 целиком, 216 байт страницы 0x2100
+	fill (image, 600, 1);
+	progSpiModel.resetStatistics ();
+	neighbour.writePage<flash> (0x1F80, image, 600);
+	check (written (progSpiModel.flash (), 0x1F80, image, 600), "flash block split wrong");
+	check (progSpiModel.getStatistics ().flashPagesWritten == 3, "flash block is not written one page write per page");
+
+	// Нечётные начало и длина
+	neighbour.writePage<flash> (0x3001, image, 3);
+	check (written (progSpiModel.flash (), 0x3001, image, 3), "odd flash block written wrong");
+
+	// eeprom: страницы по 8 байт, 3 + 8 + 8 + 2 байта
+	progSpiModel.resetStatistics ();
+	neighbour.writePage<eeprom> (5, image, 21);
+	check (written (progSpiModel.eeprom (), 5, image, 21), "eeprom block split wrong");
+	check (progSpiModel.getStatistics ().eepromPagesWritten == 4 && progSpiModel.getStatistics ().eepromBytesWritten == 21,
+		   "eeprom block is not written one page write per page");
+
+	check (progSpiModel.getStatistics ().busyInstructions == 0 && progSpiModel.getStatistics ().protocolErrors == 0,
+		   "protocol error in block writes");
+	printf ("  split: flash 600 bytes at 0x1F80 - 3 pages, eeprom 21 bytes at 5 - 4 pages\n");
+}
+
+static void boundary ()
+{
+	fill (image, 512, 2);
+	neighbour.writePage<flash> (0x1FF00, image, 512);					// Страницы по обе стороны границы
+	check (memcmp (progSpiModel.flash () + 0x1FF00, image, 512) == 0, "flash pages around 128 kB written wrong");
+
+	for (uint32_t start = 0x1FFF0; start < 0x20000; ++start)
+	{
+		uint8_t data[40];
+		neighbour.readBlock<flash> (start, data, sizeof (data));
+		if ( memcmp (data, image + (start - 0x1FF00), sizeof (data)) != 0 )
+		{
+			printf ("  readBlock from 0x%X across the 64K word boundary is wrong\n", (unsigned)start);
+			check (false, "readBlock across the 64K word boundary");
+			return;
+		}
+	}
+	// Обратно через границу: Load Extended Address должен вернуться к 0
+	uint8_t data[4];
+	neighbour.readBlock<flash> (0x1FF00, data, sizeof (data));
+	check (memcmp (data, image, sizeof (data)) == 0, "readBlock after the boundary did not reload extended address");
+	check (progSpiModel.getStatistics ().protocolErrors == 0, "protocol error around the 64K word boundary");
+	printf ("  boundary: readBlock across word 0xFFFF - 0x10000 from 16 even and odd starts\n");
+}
+
+static void whole ()
+{
+	fill (image, flashSize, 3);
+	neighbour.erase ();
+	progSpiModel.resetStatistics ();
+
+	uint64_t start = progSpiModel.time ();
+	for (uint32_t a = 0; a < flashSize; a += 1024)
+		neighbour.writePage<flash> (a, image + a, 1024);
+	double write = elapsed (start) / 1000000;
+	check (memcmp (progSpiModel.flash (), image, flashSize) == 0, "flash image differs after writePage");
+	check (progSpiModel.getStatistics ().flashPagesWritten == flashSize / 256, "flash image pages written more than once");
+
+	start = progSpiModel.time ();
+	for (uint32_t a = 0; a < flashSize; a += 1024)
+		neighbour.readBlock<flash> (a, back + a, 1024);
+	double read = elapsed (start) / 1000000;
+	check (memcmp (back, image, flashSize) == 0, "flash image differs after readBlock");
+	check (progSpiModel.getStatistics ().busyInstructions == 0 && progSpiModel.getStatistics ().protocolErrors == 0,
+		   "protocol error in whole flash write");
+
+	printf ("  whole flash %u kB: write %.2f s (%.1f kB/s), read %.2f s (%.1f kB/s), SPI %lu B/s\n",
+			unsigned (flashSize / 1024), write, flashSize / 1024 / write, read, flashSize / 1024 / read,
+			(unsigned long)neighbour.getByteRate ());
+}
+
+int main ()
+{
+	printf ("prog-spi-block:\n");
+	if ( !connect (neighbour) )
+		return testFailed;
+	split ();
+	boundary ();
+	whole ();
+	return testFailed;
+}
@@ -0,0 +1,89 @@
+/*
+ * prog-spi-poll.cpp
+ *
+ * Ожидание окончания записи в ProgSpiSimple с PROGSPI_POLL_READY на модели микросхемы (host/prog-spi-model.h)
+ * ***********************************************************************************************************
+ *
+ *  1. Запись страницы flash, страницы eeprom, fuse и отчистка: ожидание кончается не раньше, чем модель
+ *     закончит запись (ни одной инструкции, кроме Poll RDY/BSY, во время записи), и не позже, чем через 100 мксек
+ *     (период опроса) плюс время инструкции опроса. Печатается время ожидания против T_WD_... без опроса.
+ *  2. Микросхема, которая не отвечает готовностью: ожидание всё равно кончается через T_WD_... .
+ *  3. Запись всей flash (256 кБ) страницами: время с опросом против времени с T_WD_FLASH.
+ *
+ *  Сборка и запуск - run.sh
+ */
+
+#define PROGSPI_POLL_READY
+#include <prog-spi-test.h>
+
+static Neighbour neighbour;
+static uint8_t page[256];
+
+// Ожидание после операции operation, которая в модели длится writeTime мксек. budget - T_WD_..., мсек
+template <typename Operation>
+static void measure (const char* name, Operation operation, uint32_t writeTime, double budget)
+{
+	ProgSpiModel::Statistics before = progSpiModel.getStatistics ();
+	uint64_t start = progSpiModel.time ();
+	operation ();
+	double total = elapsed (start);
+	uint64_t polls = progSpiModel.getStatistics ().polls - before.polls;
+	double pollTime = 4 * 8 * 4 * 1000.0 / (F_CPU / 1000);	// Инструкция опроса при F4, мксек
+	double transfer = (progSpiModel.getStatistics ().instructions - before.instructions - polls) * pollTime;
+	double wait = total - transfer;
+
+	printf ("  %-12s write %5u us, wait %7.1f us (%2u polls), without polling %6.0f us\n",
+			name, (unsigned)writeTime, wait, (unsigned)polls, budget * 1000);
+	check (progSpiModel.getStatistics ().busyInstructions == before.busyInstructions, "instruction sent while the target was busy");
+	check (!progSpiModel.isBusy (), "wait ended before the write");
+	check (wait >= writeTime && wait <= writeTime + 100 + 2 * pollTime, "wait is not within one poll period of the write time");
+}
+
+int main ()
+{
+	printf ("prog-spi-poll:\n");
+	if ( !connect (neighbour) )
+		return testFailed;
+
+	fill (page, sizeof (page), 1);
+	measure ("flash page", [] { neighbour.writePage<flash> (0x1000, page, 256); },
+			 progSpiModel.flashWriteTime, T_WD_FLASH);
+	measure ("eeprom page", [] { neighbour.writePage<eeprom> (0x100, page, 8); },
+			 progSpiModel.eepromWriteTime, T_WD_EEPROM);
+	measure ("fuse", [] { neighbour.fuseWriteHigh (0xD8); }, progSpiModel.fuseWriteTime, T_WD_FUSE);
+	measure ("erase", [] { neighbour.erase (); }, progSpiModel.eraseTime, T_WD_ERASE);
+	check (progSpiModel.fuse (1) == 0xD8 && progSpiModel.flash ()[0x1000] == 0xFF, "fuse write or erase lost");
+
+	// Микросхема не сообщает о готовности: ожидание ограничено T_WD_FLASH
+	uint32_t normal = progSpiModel.flashWriteTime;
+	progSpiModel.flashWriteTime = 50000;
+	uint64_t start = progSpiModel.time ();
+	neighbour.writePage<flash> (0x2000, page, 2);
+	double stuck = elapsed (start);
+	printf ("  %-12s write %5u us, page written in %7.1f us: wait limited by T_WD_FLASH\n",
+			"stuck", (unsigned)progSpiModel.flashWriteTime, stuck);
+	check (stuck >= T_WD_FLASH * 1000 && stuck < T_WD_FLASH * 1000 * 1.2, "wait for a stuck target is not T_WD_FLASH");
+	hostDelayTime += 50000000;								// Модель дописывает страницу, пока тест не продолжил
+	progSpiModel.flashWriteTime = normal;
+
+	// Вся flash
+	enum { flashSize = 256 * 1024UL };
+	static uint8_t image[flashSize];
+	fill (image, flashSize, 2);
+	neighbour.erase ();
+	progSpiModel.resetStatistics ();
+	start = progSpiModel.time ();
+	for (uint32_t a = 0; a < flashSize; a += 256)
+		neighbour.writePage<flash> (a, image + a, 256);
+	double polled = elapsed (start) / 1000000;
+	double instruction = 4 * 8 * 4.0 / F_CPU;
+	double fixed = flashSize / 256 * (257 * instruction + T_WD_FLASH / 1000);
+	printf ("  whole flash  %u kB in %.2f s (%.1f kB/s), with T_WD_FLASH %.2f s (%.1f kB/s)\n",
+			unsigned (flashSize / 1024), polled, flashSize / 1024 / polled, fixed, flashSize / 1024 / fixed);
+	check (memcmp (progSpiModel.flash (), image, flashSize) == 0, "flash image differs");
+	check (progSpiModel.getStatistics ().flashPagesWritten == flashSize / 256, "wrong number of page writes");
+	check (progSpiModel.getStatistics ().busyInstructions == 0, "instruction sent while the target was busy");
+	check (polled < fixed, "polling is not faster than T_WD_FLASH");
+
+	return testFailed;
+}
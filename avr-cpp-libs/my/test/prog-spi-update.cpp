@@ -0,0 +1,109 @@
+/*
+ * prog-spi-update.cpp
+ *
+ * comparePage и updatePage ProgSpiSimple на модели микросхемы (host/prog-spi-model.h)
+ * ***********************************************************************************
+ *
+ *  1. flash: совпадающая страница пропускается (pagesSkipped, без записи), страница, где биты меняются
+ *     только 1 -> 0, записывается, страница, где нужен 0 -> 1, даёт needErase: updatePage возвращает false
+ *     и ничего не пишет.
+ *  2. eeprom: в буфер страницы загружаются и записываются только изменившиеся байты, совпавшая страница пропускается.
+ *  3. Обновление всей flash (256 кБ), в которой изменились 4 страницы: время updatePage против writePage всего образа.
+ *
+ *  Сборка и запуск - run.sh
+ */
+
+#define PROGSPI_POLL_READY
+#include <prog-spi-test.h>
+
+static Neighbour neighbour;
+
+enum { flashSize = 256 * 1024UL };
+static uint8_t image[flashSize];
+
+static void flashPages ()
+{
+	uint8_t page[256];
+	fill (page, sizeof (page), 1);
+	neighbour.writePage<flash> (0x4000, page, sizeof (page));
+	progSpiModel.resetStatistics ();
+	neighbour.pagesSkipped = 0;
+
+	check (neighbour.comparePage<flash> (0x4000, page, sizeof (page)) == equal, "equal page not reported equal");
+	check (neighbour.updatePage<flash> (0x4000, page, sizeof (page)), "updatePage failed on an equal page");
+	check (neighbour.pagesSkipped == 1 && progSpiModel.getStatistics ().flashPagesWritten == 0, "equal page was written");
+
+	page[10] &= 0x0F;
+	page[200] = 0;
+	check (neighbour.comparePage<flash> (0x4000, page, sizeof (page)) == programmable, "1 -> 0 page not reported programmable");
+	check (neighbour.updatePage<flash> (0x4000, page, sizeof (page)), "updatePage failed on a programmable page");
+	check (progSpiModel.getStatistics ().flashPagesWritten == 1 && memcmp (progSpiModel.flash () + 0x4000, page, sizeof (page)) == 0,
+		   "programmable page was not written");
+
+	page[200] = 0x80;
+	check (neighbour.comparePage<flash> (0x4000, page, sizeof (page)) == needErase, "0 -> 1 page not reported needErase");
+	check (!neighbour.updatePage<flash> (0x4000, page, sizeof (page)), "updatePage did not refuse a page that needs erase");
+	check (progSpiModel.getStatistics ().flashPagesWritten == 1 && progSpiModel.flash ()[0x4000 + 200] == 0,
+		   "page that needs erase was written");
+	printf ("  flash: equal page skipped, 1 -> 0 page written, 0 -> 1 page refused (needErase)\n");
+}
+
+static void eepromPages ()
+{
+	uint8_t data[16];
+	fill (data, sizeof (data), 2);
+	neighbour.writePage<eeprom> (0x200, data, sizeof (data));
+	progSpiModel.resetStatistics ();
+	neighbour.pagesSkipped = 0;
+
+	data[3] ^= 0xFF;
+	data[4] ^= 0x01;
+	check (neighbour.comparePage<eeprom> (0x200, data, sizeof (data)) == programmable, "changed eeprom page not reported programmable");
+	check (neighbour.updatePage<eeprom> (0x200, data, sizeof (data)), "updatePage failed on eeprom");
+	check (memcmp (progSpiModel.eeprom () + 0x200, data, sizeof (data)) == 0, "eeprom update lost data");
+	check (progSpiModel.getStatistics ().eepromPagesWritten == 1 && progSpiModel.getStatistics ().eepromBytesWritten == 2,
+		   "eeprom update wrote more than the changed bytes");
+	check (neighbour.pagesSkipped == 1, "equal eeprom page was not skipped");
+	printf ("  eeprom: 2 changed bytes of 16 - 1 page write of 2 bytes, 1 page skipped\n");
+}
+
+static void firmware ()
+{
+	fill (image, flashSize, 3);
+	neighbour.erase ();
+	uint64_t start = progSpiModel.time ();
+	for (uint32_t a = 0; a < flashSize; a += 256)
+		neighbour.writePage<flash> (a, image + a, 256);
+	double full = elapsed (start) / 1000000;
+
+	// Новая версия: 4 страницы отличаются, только сбросом битов
+	static const uint32_t changed[] = { 0x00100, 0x1FF00, 0x20000, 0x3FF00 };
+	for (uint32_t a : changed)
+		image[a + 17] &= 0xF0;
+	progSpiModel.resetStatistics ();
+	neighbour.pagesSkipped = 0;
+	bool ok = true;
+	start = progSpiModel.time ();
+	for (uint32_t a = 0; a < flashSize; a += 256)
+		ok = neighbour.updatePage<flash> (a, image + a, 256) && ok;
+	double update = elapsed (start) / 1000000;
+
+	check (ok, "updatePage refused a programmable page");
+	check (memcmp (progSpiModel.flash (), image, flashSize) == 0, "flash differs after update");
+	check (progSpiModel.getStatistics ().flashPagesWritten == 4 && neighbour.pagesSkipped == flashSize / 256 - 4,
+		   "update did not write exactly the changed pages");
+	check (progSpiModel.getStatistics ().busyInstructions == 0 && progSpiModel.getStatistics ().protocolErrors == 0,
+		   "protocol error in update");
+	printf ("  firmware %u kB, 4 pages changed: update %.2f s, full write %.2f s\n", unsigned (flashSize / 1024), update, full);
+}
+
+int main ()
+{
+	printf ("prog-spi-update:\n");
+	if ( !connect (neighbour) )
+		return testFailed;
+	flashPages ();
+	eepromPages ();
+	firmware ();
+	return testFailed;
+}
@@ -0,0 +1,31 @@
+#!/bin/sh
+#
+# Сборка и запуск тестов библиотеки на компьютере (g++).
+# Заголовки AVR подменяются заглушками из host/, остальное - код библиотеки как есть.
+#
+#   ./run.sh				- все тесты
+#   ./run.sh seq-safe-stress	- один тест
+#
+
+cd "$(dirname "$0")" || exit 1
+
+CXX=${CXX:-g++}
+OUT=${OUT:-/tmp/avr-cpp-libs-test}
+mkdir -p "$OUT"
+
+if [ $# -eq 0 ]; then
+	set -- $(ls *.cpp | sed 's/\.cpp$//')
+fi
+
+failed=0
+for t in "$@"; do
+	if ! $CXX -std=gnu++11 -O2 -g -Wall -Wextra -Werror \
+			-I host -I .. -I ../../foreign "$t.cpp" -o "$OUT/$t"; then
+		echo "$t: BUILD FAILED"
+		failed=1
+	elif ! "$OUT/$t"; then
+		echo "$t: FAILED"
+		failed=1
+	fi
+done
+exit $failed
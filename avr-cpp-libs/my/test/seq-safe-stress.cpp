@@ -0,0 +1,102 @@
+/*
+ * seq-safe-stress.cpp
+ *
+ * Нагрузочная проверка SeqSafe (thread-safe.h)
+ * ********************************************
+ *
+ *  Писатель - обработчик SIGALRM, который прерывает основной поток в произвольном месте, как прерывание AVR.
+ *  Читатель - основной цикл. Каждая запись - структура, все байты которой вычисляются из номера записи,
+ *  поэтому любая рваная копия видна сразу.
+ *
+ *  Для контроля та же структура копируется ещё и без защиты. Там рваные копии должны находиться:
+ *  иначе прерывание не попадает внутрь копирования, и проверка SeqSafe ничего не доказывает.
+ *
+ *  Сборка и запуск - run.sh
+ */
+
+#include <cpp/thread-safe.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+
+struct Telemetry
+{
+	uint32_t number;
+	uint8_t fill[200];
+};
+
+static SeqSafe<Telemetry> telemetry;
+static Telemetry plain;
+static volatile uint32_t writes = 0;
+
+static void make (Telemetry& t, uint32_t number)
+{
+	t.number = number;
+	for (uint16_t i = 0; i < sizeof(t.fill); ++i)
+		t.fill[i] = uint8_t(number * 7 + i);
+}
+
+static bool consistent (const Telemetry& t)
+{
+	for (uint16_t i = 0; i < sizeof(t.fill); ++i)
+		if ( t.fill[i] != uint8_t(t.number * 7 + i) )
+			return false;
+	return true;
+}
+
+static void writer (int)
+{
+	Telemetry t;
+	make (t, writes + 1);
+	telemetry <<= t;
+	for (uint16_t i = 0; i < sizeof(Telemetry); ++i)
+		((volatile uint8_t*)&plain)[i] = ((uint8_t*)&t)[i];
+	writes ++;
+}
+
+int main ()
+{
+	const uint32_t targetWrites = 100000;
+
+	Telemetry t;
+	make (t, 0);
+	telemetry <<= t;
+	plain = t;
+
+	signal (SIGALRM, &writer);
+	itimerval timer = { {0, 10}, {0, 10} };
+	setitimer (ITIMER_REAL, &timer, 0);
+
+	uint32_t reads = 0, torn = 0, plainTorn = 0, last = 0;
+	while ( writes < targetWrites )
+	{
+		Telemetry r;
+		if ( reads & 1 )
+			r <<= telemetry;
+		else
+			r = +telemetry;
+		if ( !consistent (r) || r.number < last )
+			torn ++;
+		last = r.number;
+
+		for (uint16_t i = 0; i < sizeof(Telemetry); ++i)
+			((uint8_t*)&r)[i] = ((volatile uint8_t*)&plain)[i];
+		if ( !consistent (r) )
+			plainTorn ++;
+		reads ++;
+	}
+
+	timer = itimerval ();
+	setitimer (ITIMER_REAL, &timer, 0);
+
+	printf ("seq-safe-stress: writes %u, reads %u, torn %u, torn without SeqSafe %u\n",
+			(unsigned)writes, (unsigned)reads, (unsigned)torn, (unsigned)plainTorn);
+	if ( torn != 0 )
+		return 1;
+	if ( plainTorn == 0 )
+	{
+		printf ("seq-safe-stress: interrupts never hit a copy, the test proves nothing\n");
+		return 1;
+	}
+	return 0;
+}